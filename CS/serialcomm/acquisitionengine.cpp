@@ -0,0 +1,198 @@
+#include "acquisitionengine.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QDebug>
+#include <limits>
+
+AcquisitionEngine::AcquisitionEngine(QObject *parent) :
+    QObject(parent),
+    m_ironCore(new IronCoreMonitor(this)),
+    m_partialDischarge(new PartialDischargeMonitor(this)),
+    m_microWater(new MicroWaterMonitor(this)),
+    m_hub(new WebSocketHub(this)),
+    m_history(new SampleHistory(this)),
+    m_sampleLog(new SampleLog(this)),
+    m_replay(nullptr)
+{
+    m_hub->setHistory(m_history);
+    m_hub->setSampleLog(m_sampleLog);
+    for (DeviceMonitor *monitor : monitors()) {
+        m_hub->addMonitor(monitor);
+        // sampleReady 从总线线程发出，排队到本线程写入
+        connect(monitor, &DeviceMonitor::sampleReady, this, &AcquisitionEngine::appendHistory);
+        connect(monitor, &DeviceMonitor::sampleReady, m_sampleLog, &SampleLog::append);
+    }
+}
+
+bool AcquisitionEngine::loadConfig(const QString &path, QString *errorString)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = QString("无法打开配置文件 %1: %2").arg(path, file.errorString());
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!doc.isObject()) {
+        if (errorString) *errorString = QString("配置文件格式错误 %1: %2").arg(path, parseError.errorString());
+        return false;
+    }
+    m_config = doc.object();
+    return true;
+}
+
+QList<DeviceMonitor *> AcquisitionEngine::monitors() const
+{
+    return { m_ironCore, m_partialDischarge, m_microWater };
+}
+
+int AcquisitionEngine::start()
+{
+    applyLogConfig(m_config.value("log").toObject());
+
+    int failures = 0;
+    const QJsonObject historyConfig = m_config.value("history").toObject();
+    if (historyConfig.contains("capacity")) {
+        m_history->setCapacity(historyConfig.value("capacity").toInt(SampleHistory::DefaultCapacity));
+    }
+    // 历史在后台回放，不等它完成就开始采集
+    if (!openStorage(m_config.value("storage").toObject())) ++failures;
+
+    const QJsonObject webSocketConfig = m_config.value("webSocket").toObject();
+    applyBackpressureConfig(webSocketConfig.value("backpressure").toObject());
+    m_hub->setFreshnessWindow(webSocketConfig.value("freshnessMs").toInt(m_hub->freshnessWindow()));
+    int hubPort = webSocketConfig.value("port").toInt(WebSocketHub::DefaultPort);
+    if (hubPort > 0 && !m_hub->listen(static_cast<quint16>(hubPort))) ++failures;
+
+    const QJsonObject monitorConfigs = m_config.value("monitors").toObject();
+    for (DeviceMonitor *monitor : monitors()) {
+        QJsonObject config = monitorConfigs.value(monitor->name()).toObject();
+        if (!config.value("enabled").toBool(true)) continue;
+        if (!startMonitor(monitor, config)) ++failures;
+    }
+    return failures;
+}
+
+void AcquisitionEngine::stop()
+{
+    m_hub->close();
+    for (DeviceMonitor *monitor : monitors()) {
+        monitor->closePort();
+    }
+    delete m_replay; // 中断未完成的回放
+    m_replay = nullptr;
+    m_replayBacklog.clear();
+    m_sampleLog->close();
+}
+
+bool AcquisitionEngine::startMonitor(DeviceMonitor *monitor, const QJsonObject &config)
+{
+    monitor->setWebSocketPort(static_cast<quint16>(config.value("webSocketPort").toInt(monitor->webSocketPort())));
+    bool ok = monitor->webSocketPort() == 0 || m_hub->listen(monitor->webSocketPort(), monitor);
+
+    QString portName = config.value("serialPort").toString();
+    if (portName.isEmpty()) return ok;
+    if (!monitor->openPort(portName, config.value("baudRate").toInt(9600))) return false;
+    applyBusConfig(monitor, m_config.value("bus").toObject());
+
+    monitor->setReadParameters(static_cast<quint8>(config.value("slaveId").toInt(monitor->slaveId())),
+                               static_cast<quint16>(config.value("address").toInt(monitor->readAddress())),
+                               static_cast<quint16>(config.value("count").toInt(monitor->readCount())));
+    monitor->setInterval(config.value("interval").toInt(monitor->interval()));
+    if (config.value("autoPoll").toBool()) {
+        monitor->startPolling(config);
+    }
+    return ok;
+}
+
+void AcquisitionEngine::applyLogConfig(const QJsonObject &config)
+{
+    LogBuffer *log = LogBuffer::instance();
+    if (config.contains("capacity")) log->setCapacity(config.value("capacity").toInt(LogBuffer::DefaultCapacity));
+
+    LogLevel level;
+    QString levelName = config.value("level").toString();
+    if (LogBuffer::levelFromName(levelName, &level)) {
+        log->setMinimumLevel(level);
+    } else if (!levelName.isEmpty()) {
+        qWarning().noquote() << "未知的日志级别:" << levelName;
+    }
+
+    if (config.contains("file")) {
+        QString error;
+        if (!log->setFileSink(config.value("file").toString(), &error)) qWarning().noquote() << error;
+    }
+}
+
+void AcquisitionEngine::applyBackpressureConfig(const QJsonObject &config)
+{
+    WebSocketHub::BackpressurePolicy policy = WebSocketHub::LatestOnly;
+    QString name = config.value("policy").toString(WebSocketHub::policyName(policy));
+    if (!WebSocketHub::policyFromName(name, &policy)) {
+        qWarning().noquote() << "未知的积压策略:" << name;
+    }
+    m_hub->setBackpressure(policy, static_cast<qint64>(config.value("maxQueuedBytes").toDouble(256 * 1024)));
+}
+
+void AcquisitionEngine::applyBusConfig(DeviceMonitor *monitor, const QJsonObject &config)
+{
+    // 缺省为拉长超出容量的周期，利用率上限 0.8
+    ModbusPollScheduler::OverloadPolicy policy = ModbusPollScheduler::StretchOverload;
+    QString policyName = config.value("overloadPolicy").toString("stretch");
+    if (policyName == "reject") {
+        policy = ModbusPollScheduler::RejectOverload;
+    } else if (policyName != "stretch") {
+        qWarning().noquote() << "未知的总线超载策略:" << policyName;
+    }
+    monitor->setBusCapacity(config.value("maxUtilization").toDouble(0.8), policy);
+    monitor->setCoalesceGap(config.value("coalesceGap").toInt(0));
+}
+
+bool AcquisitionEngine::openStorage(const QJsonObject &config)
+{
+    QString directory = config.value("directory").toString();
+    if (directory.isEmpty()) return true;
+
+    m_sampleLog->setSegmentSize(static_cast<qint64>(config.value("segmentBytes").toDouble(16 * 1024 * 1024)));
+    m_sampleLog->setRetention(static_cast<qint64>(config.value("maxBytes").toDouble(0)),
+                              config.value("maxAgeDays").toInt(30));
+    m_sampleLog->setSyncInterval(config.value("syncIntervalMs").toInt(1000));
+    QString error;
+    if (!m_sampleLog->open(directory, &error)) {
+        qWarning().noquote() << error;
+        return false;
+    }
+
+    // 快照只含打开时已有的记录，之后到达的样本由 appendHistory() 另外记下，不会重复
+    qint64 fromMs = QDateTime::currentMSecsSinceEpoch()
+            - qint64(config.value("replayHours").toDouble(168) * 3600 * 1000);
+    delete m_replay;
+    m_replayBacklog.clear();
+    m_replay = new SampleReplay(m_sampleLog->snapshot(), fromMs, std::numeric_limits<qint64>::max(),
+                                m_history->capacity(), this);
+    connect(m_replay, &QThread::finished, this, &AcquisitionEngine::finishReplay);
+    m_replay->start(QThread::LowPriority);
+    return true;
+}
+
+void AcquisitionEngine::appendHistory(const DeviceSample &sample)
+{
+    m_history->append(sample);
+    if (m_replay) m_replayBacklog.append(sample);
+}
+
+void AcquisitionEngine::finishReplay()
+{
+    if (!m_replay) return;
+    // 回放结果都早于回放期间到达的样本，补上后整体换入
+    SampleHistory *replayed = m_replay->history();
+    for (const DeviceSample &sample : qAsConst(m_replayBacklog)) replayed->append(sample);
+    m_history->swap(*replayed);
+    LogBuffer::instance()->append(LogLevel::Info, "storage", QString("已回放 %1 条历史记录，耗时 %2ms")
+                                  .arg(m_replay->replayed()).arg(m_replay->elapsedMs()));
+    m_replay->deleteLater();
+    m_replay = nullptr;
+    m_replayBacklog.clear();
+}
@@ -0,0 +1,82 @@
+#ifndef ACQUISITIONENGINE_H
+#define ACQUISITIONENGINE_H
+
+#include <QObject>
+#include <QList>
+#include <QJsonObject>
+#include "ironcoremonitor.h"
+#include "partialdischargemonitor.h"
+#include "microwatermonitor.h"
+#include "websockethub.h"
+#include "samplehistory.h"
+#include "samplelog.h"
+#include "samplereplay.h"
+
+// 采集引擎: 持有三类设备的采集服务，按配置文件启动 WebSocket 服务、打开串口并开始轮询。
+// 无界面守护进程直接运行它；图形界面在它之上只做显示和手动操作。
+//
+// 配置文件(JSON)示例见 serialcomm.example.json:
+//   { "monitors": { "ironCore": { "enabled": true, "webSocketPort": 8080,
+//                                  "serialPort": "ttyUSB0", "baudRate": 2400,
+//                                  "autoPoll": true, "interval": 5000,
+//                                  "slaveId": 1, "address": 0, "count": 12, "jobs": [...] },
+//                   "partialDischarge": {...}, "microWater": {...} },
+//   "webSocket": { "port": 8090 },
+//   "history": { "capacity": 17280 },
+//   "storage": { "directory": "data", "segmentBytes": 16777216, "maxBytes": 1073741824,
+//                "maxAgeDays": 30, "syncIntervalMs": 1000, "replayHours": 168 },
+//   "log": { "level": "info", "capacity": 5000, "file": "serialcomm.log" } }
+// webSocket.port 为所有设备共用的多路复用端口(0 为不开)，各设备的 webSocketPort 为兼容旧前端的端口。
+// 未出现的设备按默认端口启动兼容端口，不打开串口。
+// history.capacity 为内存中每个设备/从站保留的最近样本条数，供 GET_HISTORY 查询。
+// storage.directory 不为空时样本同时写入磁盘日志(SampleLog)，启动时在后台线程把最近 replayHours 小时的
+// 记录回放到内存历史中(SampleReplay)，重启后前端仍能查到之前的数据；默认 168 小时，正好重建
+// 1 分钟汇总保留的 7 天。采集不等回放完成，回放结束前查询只能看到新数据。
+// segmentBytes 为活动分段写满的大小，写满的分段在后台压缩封存，maxBytes 按压缩后的大小计。
+class AcquisitionEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AcquisitionEngine(QObject *parent = nullptr);
+
+    // 读取配置文件，失败时返回 false 并给出原因
+    bool loadConfig(const QString &path, QString *errorString = nullptr);
+    void setConfig(const QJsonObject &config) { m_config = config; }
+
+    // 按配置启动所有启用的设备，返回未能全部启动的设备数
+    int start();
+    void stop();
+
+    IronCoreMonitor *ironCore() const { return m_ironCore; }
+    PartialDischargeMonitor *partialDischarge() const { return m_partialDischarge; }
+    MicroWaterMonitor *microWater() const { return m_microWater; }
+    QList<DeviceMonitor *> monitors() const;
+    WebSocketHub *hub() const { return m_hub; }
+    SampleHistory *history() const { return m_history; }
+    SampleLog *sampleLog() const { return m_sampleLog; }
+
+private:
+    bool startMonitor(DeviceMonitor *monitor, const QJsonObject &config);
+    // 日志级别(frame/debug/info/warning/error)、缓冲条数和输出文件("-" 为标准输出)
+    void applyLogConfig(const QJsonObject &config);
+    void applyBackpressureConfig(const QJsonObject &config);
+    void applyBusConfig(DeviceMonitor *monitor, const QJsonObject &config);
+    // 打开磁盘日志并开始后台回放，未配置目录时返回 true
+    bool openStorage(const QJsonObject &config);
+    // 样本写入内存历史；回放期间另存一份，回放完成后补进回放结果
+    void appendHistory(const DeviceSample &sample);
+    void finishReplay();
+
+    QJsonObject m_config;
+    IronCoreMonitor *m_ironCore;
+    PartialDischargeMonitor *m_partialDischarge;
+    MicroWaterMonitor *m_microWater;
+    WebSocketHub *m_hub;
+    SampleHistory *m_history;
+    SampleLog *m_sampleLog;
+    SampleReplay *m_replay;                // 正在进行的历史回放，无则为空
+    QVector<DeviceSample> m_replayBacklog; // 回放期间到达的样本
+};
+
+#endif // ACQUISITIONENGINE_H
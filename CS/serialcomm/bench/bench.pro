@@ -0,0 +1,31 @@
+# 通讯/存储内核的基准测试程序(控制台)，与主程序共用源文件
+# 用法: qmake bench.pro && make && ./SerialCommBench [套件名...]
+QT       += core
+QT       -= gui
+
+CONFIG   += console c++14
+CONFIG   -= app_bundle
+
+TARGET = SerialCommBench
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    main.cpp \
+    benchsamples.cpp \
+    crcbenchmark.cpp \
+    codecbenchmark.cpp \
+    blockcodecbenchmark.cpp \
+    ../modbuscrc.cpp \
+    ../devicesample.cpp \
+    ../samplecodec.cpp \
+    ../sampleblockcodec.cpp
+
+HEADERS += \
+    benchmarks.h \
+    benchsamples.h \
+    ../modbuscrc.h \
+    ../devicesample.h \
+    ../samplecodec.h \
+    ../sampleblockcodec.h
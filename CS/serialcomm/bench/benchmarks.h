@@ -0,0 +1,30 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <functional>
+
+// 运行 fn 直到累计耗时不少于 minMs，返回每次调用的平均纳秒数
+inline double measureNsPerCall(const std::function<void()> &fn, qint64 minMs = 200)
+{
+    fn(); // 预热
+    qint64 calls = 0;
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        for (int i = 0; i < 64; ++i) fn();
+        calls += 64;
+    } while (timer.elapsed() < minMs);
+    return static_cast<double>(timer.nsecsElapsed()) / calls;
+}
+
+// 防止编译器把基准循环优化掉
+extern volatile quint64 g_benchSink;
+
+// 各套件校验失败(结果与输入不一致)时返回 false
+bool runCrcBenchmark();
+bool runCodecBenchmark();
+bool runBlockCodecBenchmark();
+
+#endif // BENCHMARKS_H
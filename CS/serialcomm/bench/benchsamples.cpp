@@ -0,0 +1,73 @@
+#include "benchsamples.h"
+#include <algorithm>
+#include <random>
+
+DeviceSample makeSample(DeviceKind kind)
+{
+    DeviceSample sample;
+    sample.kind = kind;
+    sample.slaveId = 1;
+    sample.timestampMs = 1700000000123;
+    sample.deviceTime = 1700000000;
+    switch (kind) {
+    case DeviceKind::IronCore: {
+        // 电流(μA)
+        const qint64 values[] = { 125430, 8210, 0 };
+        sample.valueCount = 3;
+        std::copy(values, values + 3, sample.values);
+        break;
+    }
+    case DeviceKind::PartialDischarge: {
+        const qint64 values[] = { 3, 50, 1234567, 2345, 78, 1, 0, 0 };
+        sample.valueCount = 8;
+        std::copy(values, values + 8, sample.values);
+        break;
+    }
+    case DeviceKind::MicroWater: {
+        // 温度/压力/密度/微水/露点 ×100
+        const qint64 values[] = { 2345, 60, 3520, 12345, -4321, 0, 0 };
+        sample.valueCount = 7;
+        std::copy(values, values + 7, sample.values);
+        break;
+    }
+    }
+    return sample;
+}
+
+QVector<DeviceSample> makeSeries(DeviceKind kind, int count)
+{
+    std::mt19937 random(static_cast<unsigned>(kind));
+    std::uniform_int_distribution<int> jitter(-3, 3);
+    std::uniform_int_distribution<int> step(-2, 2);
+    std::uniform_int_distribution<int> pulses(0, 40);
+
+    DeviceSample sample = makeSample(kind);
+    QVector<DeviceSample> series;
+    series.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        DeviceSample current = sample;
+        current.timestampMs += qint64(i) * 5000 + jitter(random);
+        current.deviceTime += i * 5;
+        series.append(current);
+
+        if (kind == DeviceKind::PartialDischarge) {
+            sample.values[DeviceSample::PdTotalCount] += pulses(random);
+            sample.values[DeviceSample::PdAmount] += step(random) * 10;
+            sample.values[DeviceSample::PdStrength] += step(random);
+        } else {
+            // 前几个为模拟量，其余为状态
+            const int analog = kind == DeviceKind::IronCore ? 2 : 5;
+            for (int field = 0; field < analog; ++field) sample.values[field] += step(random);
+        }
+    }
+    return series;
+}
+
+bool sameSample(const DeviceSample &a, const DeviceSample &b)
+{
+    if (a.kind != b.kind || a.slaveId != b.slaveId || a.timestampMs != b.timestampMs
+            || a.deviceTime != b.deviceTime || a.valueCount != b.valueCount) {
+        return false;
+    }
+    return std::equal(a.values, a.values + a.valueCount, b.values);
+}
@@ -0,0 +1,17 @@
+#ifndef BENCHSAMPLES_H
+#define BENCHSAMPLES_H
+
+#include <QVector>
+#include "devicesample.h"
+
+// 各基准共用的模拟数据
+
+// 一条典型的样本，数值取自现场设备的量级
+DeviceSample makeSample(DeviceKind kind);
+// 从 makeSample() 开始的连续采集: 周期 5 秒、接收时间有几毫秒抖动，模拟量缓慢漂移，
+// 局放计数单调递增，状态基本不变
+QVector<DeviceSample> makeSeries(DeviceKind kind, int count);
+// 逐字段比较(种类、从站、两个时间、字段数和每个数值)
+bool sameSample(const DeviceSample &a, const DeviceSample &b);
+
+#endif // BENCHSAMPLES_H
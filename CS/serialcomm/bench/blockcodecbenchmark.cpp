@@ -0,0 +1,54 @@
+#include "benchmarks.h"
+#include "sampleblockcodec.h"
+#include "benchsamples.h"
+#include <QTextStream>
+#include <QVector>
+
+namespace {
+const int kSamplesPerBlock = 720; // 5 秒周期一小时
+}
+
+bool runBlockCodecBenchmark()
+{
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6\n")
+           .arg("device", 18).arg("raw bytes", 10).arg("block bytes", 12)
+           .arg("ratio", 7).arg("encode MB/s", 12).arg("decode MB/s", 12);
+
+    const DeviceKind kinds[] = { DeviceKind::IronCore, DeviceKind::PartialDischarge, DeviceKind::MicroWater };
+    for (DeviceKind kind : kinds) {
+        const QVector<DeviceSample> series = makeSeries(kind, kSamplesPerBlock);
+        // 未压缩的列存储: 接收时间、设备时间和各字段各 8 字节
+        const qint64 rawBytes = qint64(series.size()) * (2 + series.first().valueCount) * 8;
+        const QByteArray block = SampleBlockCodec::encode(series);
+
+        QVector<DeviceSample> decoded;
+        if (!SampleBlockCodec::decode(block, &decoded) || decoded.size() != series.size()) {
+            out << DeviceSample::kindName(kind) << ": 解码失败\n";
+            return false;
+        }
+        // 逐条逐字段比较: 接收时间、设备时间和每个数值
+        for (int i = 0; i < series.size(); ++i) {
+            if (!sameSample(decoded.at(i), series.at(i))) {
+                out << DeviceSample::kindName(kind) << ": 第 " << i << " 条解码结果与输入不一致\n";
+                return false;
+            }
+        }
+
+        double encodeNs = measureNsPerCall([&] { g_benchSink += SampleBlockCodec::encode(series).size(); });
+        double decodeNs = measureNsPerCall([&] {
+            SampleBlockCodec::decode(block, &decoded);
+            g_benchSink += decoded.size();
+        });
+
+        // 吞吐量按未压缩数据量计算
+        out << QString("%1 %2 %3 %4 %5 %6\n")
+               .arg(DeviceSample::kindName(kind), 18)
+               .arg(rawBytes, 10)
+               .arg(block.size(), 12)
+               .arg(double(rawBytes) / block.size(), 6, 'f', 1)
+               .arg(rawBytes * 1000.0 / encodeNs, 12, 'f', 0)
+               .arg(rawBytes * 1000.0 / decodeNs, 12, 'f', 0);
+    }
+    return true;
+}
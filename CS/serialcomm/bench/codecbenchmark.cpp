@@ -0,0 +1,72 @@
+#include "benchmarks.h"
+#include "samplecodec.h"
+#include "benchsamples.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+namespace {
+// 与 WebSocketHub 推送的 SAMPLE 消息相同的结构: 带小数的字段格式化为字符串，时间为文本
+QByteArray encodeJson(const DeviceSample &sample)
+{
+    int count = 0;
+    const DeviceField *descriptors = DeviceSample::fields(sample.kind, &count);
+    QJsonObject data;
+    data["slaveId"] = sample.slaveId;
+    if (sample.deviceTime) {
+        data["time"] = QDateTime::fromSecsSinceEpoch(sample.deviceTime).toString("yyyy-MM-dd hh:mm:ss");
+    }
+    for (int i = 0; i < count; ++i) {
+        if (descriptors[i].decimals > 0) {
+            data[QLatin1String(descriptors[i].key)] = sample.formattedValue(i);
+        } else {
+            data[QLatin1String(descriptors[i].key)] = static_cast<double>(sample.values[i]);
+        }
+    }
+    QJsonObject message;
+    message["type"] = "SAMPLE";
+    message["device"] = DeviceSample::kindName(sample.kind);
+    message["slaveId"] = sample.slaveId;
+    message["timestamp"] = static_cast<double>(sample.timestampMs);
+    message["data"] = data;
+    return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
+}
+
+bool runCodecBenchmark()
+{
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6\n")
+           .arg("device", 18).arg("json bytes", 11).arg("binary bytes", 13)
+           .arg("json ns", 10).arg("binary ns", 10).arg("speedup", 9);
+
+    const DeviceKind kinds[] = { DeviceKind::IronCore, DeviceKind::PartialDischarge, DeviceKind::MicroWater };
+    for (DeviceKind kind : kinds) {
+        const DeviceSample sample = makeSample(kind);
+        const int jsonBytes = encodeJson(sample).size();
+        const QByteArray record = SampleCodec::encode(sample);
+        const int binaryBytes = record.size();
+
+        // 解码后须与输入完全一致
+        DeviceSample decoded;
+        quint8 mask = 0;
+        if (!SampleCodec::decode(record, &decoded, &mask) || mask != SampleCodec::AllFields
+                || !sameSample(decoded, sample)) {
+            out << DeviceSample::kindName(kind) << ": 二进制记录解码结果与输入不一致\n";
+            return false;
+        }
+
+        double jsonNs = measureNsPerCall([&] { g_benchSink += encodeJson(sample).size(); });
+        double binaryNs = measureNsPerCall([&] { g_benchSink += SampleCodec::encode(sample).size(); });
+
+        out << QString("%1 %2 %3 %4 %5 %6x\n")
+               .arg(DeviceSample::kindName(kind), 18)
+               .arg(jsonBytes, 11)
+               .arg(binaryBytes, 13)
+               .arg(jsonNs, 10, 'f', 0)
+               .arg(binaryNs, 10, 'f', 0)
+               .arg(jsonNs / binaryNs, 8, 'f', 1);
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#include "benchmarks.h"
+#include "modbuscrc.h"
+#include <QByteArray>
+#include <QTextStream>
+
+namespace {
+// 原 Widget::calculateCRC 的逐位实现，作为对照
+quint16 legacyBitwiseCrc(const char *data, int length)
+{
+    quint16 crc = 0xFFFF;
+    for (int i = 0; i < length; ++i) {
+        crc ^= static_cast<quint8>(data[i]);
+        for (int j = 0; j < 8; ++j) {
+            if (crc & 0x0001) {
+                crc >>= 1;
+                crc ^= 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+}
+
+bool runCrcBenchmark()
+{
+    QTextStream out(stdout);
+
+    // 8字节为请求帧，29字节为12寄存器应答，256字节为最大RTU帧，64KB模拟大块读取
+    const int sizes[] = { 8, 29, 256, 65536 };
+    QByteArray data(65536, Qt::Uninitialized);
+    quint32 seed = 12345;
+    for (int i = 0; i < data.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = static_cast<char>(seed >> 24);
+    }
+    const char *p = data.constData();
+
+    out << QString("%1 %2 %3 %4 %5\n")
+           .arg("bytes", 8).arg("bitwise MB/s", 14).arg("table MB/s", 14)
+           .arg("slicing8 MB/s", 14).arg("speedup", 9);
+
+    for (int size : sizes) {
+        if (legacyBitwiseCrc(p, size) != ModbusCrc::updateBytewise(ModbusCrc::InitialValue, p, size)
+                || legacyBitwiseCrc(p, size) != ModbusCrc::updateSlicing8(ModbusCrc::InitialValue, p, size)) {
+            out << "CRC结果不一致，长度 " << size << "\n";
+            return false;
+        }
+
+        double legacyNs = measureNsPerCall([=] { g_benchSink += legacyBitwiseCrc(p, size); });
+        double tableNs = measureNsPerCall([=] {
+            g_benchSink += ModbusCrc::updateBytewise(ModbusCrc::InitialValue, p, size);
+        });
+        double slicingNs = measureNsPerCall([=] {
+            g_benchSink += ModbusCrc::updateSlicing8(ModbusCrc::InitialValue, p, size);
+        });
+        double best = qMin(tableNs, slicingNs);
+
+        // 字节/纳秒 * 1000 = MB/s
+        out << QString("%1 %2 %3 %4 %5x\n")
+               .arg(size, 8)
+               .arg(size * 1000.0 / legacyNs, 14, 'f', 1)
+               .arg(size * 1000.0 / tableNs, 14, 'f', 1)
+               .arg(size * 1000.0 / slicingNs, 14, 'f', 1)
+               .arg(legacyNs / best, 8, 'f', 1);
+    }
+    return true;
+}
@@ -0,0 +1,33 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include "benchmarks.h"
+
+volatile quint64 g_benchSink = 0;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList suites = app.arguments().mid(1);
+
+    struct Suite {
+        const char *name;
+        bool (*run)();
+    };
+    const Suite allSuites[] = {
+        { "crc", runCrcBenchmark },
+        { "codec", runCodecBenchmark },
+        { "block", runBlockCodecBenchmark },
+    };
+
+    int failures = 0;
+    for (const Suite &suite : allSuites) {
+        if (!suites.isEmpty() && !suites.contains(suite.name)) continue;
+        QTextStream(stdout) << "== " << suite.name << " ==\n";
+        if (!suite.run()) {
+            QTextStream(stderr) << "套件 " << suite.name << " 校验失败\n";
+            ++failures;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,508 @@
+#include "devicemonitor.h"
+#include <QtEndian>
+
+namespace {
+const int kDefaultIntervalMs = 5000;
+const quint16 kSelectionRegister = 0x0001;
+}
+
+DeviceMonitor::DeviceMonitor(DeviceKind kind, quint16 webSocketPort, QObject *parent) :
+    QObject(parent),
+    m_kind(kind),
+    m_webSocketPort(webSocketPort),
+    m_bus(nullptr),
+    m_coalescedReads(0),
+    m_intervalMs(kDefaultIntervalMs),
+    m_slaveId(1),
+    m_readAddress(0),
+    m_readCount(0)
+{
+    qRegisterMetaType<DeviceSample>("DeviceSample");
+}
+
+DeviceMonitor::~DeviceMonitor()
+{
+    closePort();
+}
+
+bool DeviceMonitor::openPort(const QString &portName, qint32 baudRate)
+{
+    if (m_bus) closePort();
+
+    m_bus = ModbusBus::acquire(portName, baudRate, &m_errorString);
+    if (!m_bus) {
+        log(LogLevel::Error, "错误: " + m_errorString);
+        return false;
+    }
+
+    connectBus();
+    log(LogLevel::Info, "串口 " + portName + " 打开成功。");
+    if (m_bus->userCount() > 1) {
+        log(LogLevel::Info, QString("该串口已被其他设备打开，共用同一总线(波特率%1)。").arg(m_bus->baudRate()));
+    }
+    emit portStateChanged(true);
+    return true;
+}
+
+void DeviceMonitor::closePort()
+{
+    if (!m_bus) return;
+    stopPolling();
+    // 在总线线程中断开，返回后不会再有本对象的槽在总线线程中执行
+    m_bus->run([this] {
+        disconnect(m_bus->master(), nullptr, this, nullptr);
+        disconnect(m_bus->scheduler(), nullptr, this, nullptr);
+        m_requestIds.clear();
+        m_pendingReads.clear();
+    });
+    ModbusBus::release(m_bus);
+    m_bus = nullptr;
+    log(LogLevel::Info, "串口已关闭。");
+    emit portStateChanged(false);
+}
+
+bool DeviceMonitor::isPortOpen() const
+{
+    return m_bus && m_bus->evaluate([this] { return m_bus->master()->isOpen(); });
+}
+
+QString DeviceMonitor::portName() const
+{
+    return m_bus ? m_bus->portName() : QString();
+}
+
+void DeviceMonitor::setReadParameters(quint8 slaveId, quint16 address, quint16 count)
+{
+    m_slaveId = slaveId;
+    m_readAddress = address;
+    m_readCount = count;
+}
+
+void DeviceMonitor::setInterval(int ms)
+{
+    if (ms <= 0) return;
+    m_intervalMs = ms;
+    if (!m_bus) return;
+    int rejected = m_bus->evaluate([this] {
+        int count = 0;
+        for (int jobId : qAsConst(m_jobIds)) {
+            if (!m_bus->scheduler()->setJobPeriod(jobId, m_intervalMs)) ++count;
+        }
+        return count;
+    });
+    if (rejected > 0) {
+        log(LogLevel::Warning, QString("警告: 间隔 %1ms 超出总线容量，%2 个轮询任务保持原周期。")
+            .arg(m_intervalMs).arg(rejected));
+    }
+}
+
+bool DeviceMonitor::applyDensestInterval()
+{
+    int interval = densestInterval();
+    if (interval <= 0) {
+        log(LogLevel::Warning, "警告: 总线已满负荷或未在轮询，无法自动设置间隔。");
+        return false;
+    }
+    setInterval(interval);
+    log(LogLevel::Info, QString("按总线容量自动设置间隔: %1ms，总线利用率 %2%")
+        .arg(interval).arg(busUtilization() * 100, 0, 'f', 1));
+    return true;
+}
+
+int DeviceMonitor::densestInterval() const
+{
+    if (!m_bus || m_jobIds.isEmpty()) return -1;
+    return m_bus->evaluate([this] { return m_bus->scheduler()->densestPeriodMs(m_jobIds); });
+}
+
+void DeviceMonitor::setBusCapacity(double maxUtilization, ModbusPollScheduler::OverloadPolicy policy)
+{
+    if (!m_bus) return;
+    m_bus->run([this, maxUtilization, policy] {
+        m_bus->scheduler()->setMaxUtilization(maxUtilization);
+        m_bus->scheduler()->setOverloadPolicy(policy);
+    });
+}
+
+void DeviceMonitor::setCoalesceGap(int registers)
+{
+    if (!m_bus) return;
+    m_bus->run([this, registers] { m_bus->scheduler()->setMaxCoalesceGap(registers); });
+}
+
+double DeviceMonitor::busUtilization() const
+{
+    return m_bus ? m_bus->evaluate([this] { return m_bus->scheduler()->utilization(); }) : 0.0;
+}
+
+void DeviceMonitor::startPolling(const QJsonObject &command)
+{
+    if (!m_bus) return;
+
+    ModbusPollJob defaults;
+    defaults.slaveId = m_slaveId;
+    defaults.functionCode = readFunctionCode();
+    defaults.address = m_readAddress;
+    defaults.count = m_readCount;
+    defaults.periodMs = m_intervalMs;
+    defaults.tag = DataRequest;
+    // 读数据前需选中本设备，已选中时调度器会跳过选择写
+    defaults.selectionCode = deviceCode();
+    defaults.selectionTag = DeviceSelectionRequest;
+
+    QList<ModbusPollJob> jobs;
+    const QJsonArray jobArray = command.value("jobs").toArray();
+    if (jobArray.isEmpty()) {
+        jobs.append(defaults);
+    } else {
+        for (const QJsonValue &value : jobArray) {
+            jobs.append(ModbusPollJob::fromJson(value.toObject(), defaults));
+        }
+    }
+
+    for (int i = jobs.size() - 1; i >= 0; --i) {
+        if (jobs.at(i).count == 0) {
+            log(LogLevel::Warning, QString("警告: 从站%1读取数量为0，忽略该轮询任务。").arg(jobs.at(i).slaveId));
+            jobs.removeAt(i);
+        }
+    }
+
+    // 新旧任务在总线线程中一次替换，中间不会漏掉或错收应答。
+    // 超出总线容量的任务按调度器策略被拒绝或拉长周期
+    bool wasPolling = isPolling();
+    QStringList notes;
+    m_jobIds = m_bus->evaluate([this, jobs, &notes] {
+        ModbusPollScheduler *scheduler = m_bus->scheduler();
+        for (int jobId : qAsConst(m_busJobIds)) {
+            scheduler->removeJob(jobId);
+        }
+        m_busJobIds.clear();
+        QList<int> jobIds;
+        for (const ModbusPollJob &job : jobs) {
+            int jobId = scheduler->addJob(job);
+            if (jobId == 0) {
+                notes.append(QString("从站%1的轮询任务超出总线容量，未启动").arg(job.slaveId));
+                continue;
+            }
+            jobIds.append(jobId);
+            m_busJobIds.insert(jobId);
+            // addJob 内发出的 periodAdjusted 早于登记任务编号，在这里补记
+            for (const ModbusPollJob &added : scheduler->jobs()) {
+                if (added.id == jobId && added.periodMs != job.periodMs) {
+                    notes.append(QString("从站%1的轮询间隔 %2ms 超出总线容量，已调整为 %3ms")
+                                 .arg(job.slaveId).arg(job.periodMs).arg(added.periodMs));
+                }
+            }
+        }
+        return jobIds;
+    });
+    for (const QString &note : qAsConst(notes)) log(LogLevel::Warning, "警告: " + note);
+    if (wasPolling != isPolling()) emit pollingStateChanged(isPolling());
+}
+
+void DeviceMonitor::stopPolling()
+{
+    if (m_jobIds.isEmpty()) return;
+    if (m_bus) {
+        m_bus->run([this] {
+            for (int jobId : qAsConst(m_busJobIds)) {
+                m_bus->scheduler()->removeJob(jobId);
+            }
+            m_busJobIds.clear();
+        });
+    }
+    m_jobIds.clear();
+    emit pollingStateChanged(false);
+}
+
+QJsonArray DeviceMonitor::jobStatistics() const
+{
+    if (!m_bus || m_jobIds.isEmpty()) return QJsonArray();
+    return m_bus->evaluate([this] { return m_bus->scheduler()->statisticsToJson(m_jobIds); });
+}
+
+QJsonArray DeviceMonitor::laneStatistics() const
+{
+    if (!m_bus) return QJsonArray();
+    return m_bus->evaluate([this] {
+        QJsonArray lanes;
+        for (int i = 0; i < ModbusRequest::LaneCount; ++i) {
+            ModbusRequest::Lane lane = static_cast<ModbusRequest::Lane>(i);
+            ModbusRtuMaster::LaneStatistics stats = m_bus->master()->laneStatistics(lane);
+            QJsonObject object;
+            object["lane"] = ModbusRtuMaster::laneName(lane);
+            object["completed"] = static_cast<double>(stats.completed);
+            object["rejected"] = static_cast<double>(stats.rejected);
+            object["queued"] = stats.queued;
+            object["maxDepth"] = stats.maxDepth;
+            object["averageWaitMs"] = stats.averageWaitMs;
+            object["maxWaitMs"] = static_cast<double>(stats.maxWaitMs);
+            object["averageLatencyMs"] = stats.averageLatencyMs;
+            object["maxLatencyMs"] = static_cast<double>(stats.maxLatencyMs);
+            lanes.append(object);
+        }
+        return lanes;
+    });
+}
+
+bool DeviceMonitor::sendOnce()
+{
+    if (!isPortOpen()) {
+        log(LogLevel::Error, "错误: 串口未打开，无法执行指令。");
+        return false;
+    }
+    if (m_readCount == 0) {
+        log(LogLevel::Warning, "警告: 读取数量为0，跳过发送。请在Web端设置参数。");
+        return false;
+    }
+
+    // 相同的读取已在总线上排队或进行中时不再重复发送，应答照常推送给所有客户端
+    const quint64 key = readKey(m_slaveId, m_readAddress, m_readCount);
+    bool pending = m_bus->evaluate([this, key] {
+        for (auto it = m_pendingReads.constBegin(); it != m_pendingReads.constEnd(); ++it) {
+            if (it.value() == key) return true;
+        }
+        return false;
+    });
+    if (pending) {
+        ++m_coalescedReads;
+        log(LogLevel::Debug, "相同的读取正在进行，合并到该次请求。");
+        return true;
+    }
+
+    log(LogLevel::Debug, "请求设备数据...");
+    ModbusRequest request = readFunctionCode() == 0x04
+            ? ModbusRequest::readInputRegisters(m_slaveId, m_readAddress, m_readCount)
+            : ModbusRequest::readHoldingRegisters(m_slaveId, m_readAddress, m_readCount);
+    request.tag = DataRequest;
+    m_bus->run([this, request, key] {
+        ModbusRtuMaster *master = m_bus->master();
+        quint32 id = 0;
+        if (needsSelection(request.slaveId)) {
+            // 选择写和读取作为一组连续发送，其他请求插不进来改变选择
+            QList<quint32> ids = master->sendChain(QList<ModbusRequest>() << selectionRequest(request.slaveId) << request);
+            if (ids.size() == 2) {
+                m_requestIds.insert(ids.at(0));
+                id = ids.at(1);
+            }
+        } else {
+            id = master->sendRequest(request);
+        }
+        if (id == 0) return; // 按需通道已满
+        m_requestIds.insert(id);
+        m_pendingReads.insert(id, key);
+    });
+    return true;
+}
+
+bool DeviceMonitor::selectDevice()
+{
+    if (deviceCode() < 0 || !isPortOpen()) return false;
+
+    log(LogLevel::Info, "步骤1: 发送指令选择要读取的设备...");
+    sendRequest(selectionRequest(m_slaveId));
+    return true;
+}
+
+void DeviceMonitor::log(LogLevel level, const QString &text) const
+{
+    LogBuffer::instance()->append(level, name(), text);
+}
+
+void DeviceMonitor::logFrame(const QString &prefix, const QByteArray &frame) const
+{
+    LogBuffer::instance()->append(LogLevel::Frame, name(), prefix, frame);
+}
+
+void DeviceMonitor::connectBus()
+{
+    // 总线可能与其他设备共享: 只处理本设备发出的请求和本设备轮询任务的应答。
+    // 帧视图只在总线线程的信号分发期间有效，这些槽直接在总线线程中执行
+    ModbusRtuMaster *master = m_bus->master();
+    connect(master, &ModbusRtuMaster::replyReceived, this, [this](const ModbusReply &reply) {
+        if (!m_requestIds.remove(reply.id)) return;
+        m_pendingReads.remove(reply.id);
+        onReplyReceived(reply);
+    }, Qt::DirectConnection);
+    connect(m_bus->scheduler(), &ModbusPollScheduler::jobReplied, this, [this](int jobId, const ModbusReply &reply) {
+        if (m_busJobIds.contains(jobId)) onReplyReceived(reply);
+    }, Qt::DirectConnection);
+    connect(m_bus->scheduler(), &ModbusPollScheduler::overrun, this, [this](int jobId, int missedCycles, qint64 latenessMs) {
+        if (m_busJobIds.contains(jobId)) {
+            log(LogLevel::Warning, QString("轮询任务 %1 落后 %2ms，跳过 %3 个周期，总线负载可能过高")
+                .arg(jobId).arg(latenessMs).arg(missedCycles));
+        }
+    }, Qt::DirectConnection);
+    connect(m_bus->scheduler(), &ModbusPollScheduler::periodAdjusted, this, [this](int jobId, int requestedMs, int periodMs) {
+        if (m_busJobIds.contains(jobId)) {
+            log(LogLevel::Warning, QString("轮询任务 %1 的间隔 %2ms 超出总线容量，已调整为 %3ms")
+                .arg(jobId).arg(requestedMs).arg(periodMs));
+        }
+    }, Qt::DirectConnection);
+    // 报文只复制原始字节，关闭报文日志时连复制也省掉
+    connect(master, &ModbusRtuMaster::frameSent, this, [this](const QByteArray &frame) {
+        if (LogBuffer::instance()->isEnabled(LogLevel::Frame)) logFrame("发送: ", frame);
+    }, Qt::DirectConnection);
+    connect(master, &ModbusRtuMaster::frameReceived, this, [this](const ModbusFrameView &frame) {
+        if (LogBuffer::instance()->isEnabled(LogLevel::Frame)) logFrame("接收: ", frame.toByteArray());
+    }, Qt::DirectConnection);
+    connect(master, &ModbusRtuMaster::errorOccurred, this, [this](const QString &message) {
+        log(LogLevel::Warning, message);
+    }, Qt::DirectConnection);
+}
+
+void DeviceMonitor::sendRequest(const ModbusRequest &request)
+{
+    m_bus->run([this, request] {
+        quint32 id = m_bus->master()->sendRequest(request);
+        if (id != 0) m_requestIds.insert(id);
+    });
+}
+
+quint64 DeviceMonitor::readKey(quint8 slaveId, quint16 address, quint16 count) const
+{
+    // 功能码、从站、起始地址、数量相同即为同一读取
+    return (quint64(readFunctionCode()) << 40) | (quint64(slaveId) << 32) | (quint64(address) << 16) | count;
+}
+
+ModbusRequest DeviceMonitor::selectionRequest(quint8 slaveId) const
+{
+    ModbusRequest request = ModbusRequest::writeSingleRegister(slaveId, kSelectionRegister,
+                                                               static_cast<quint16>(deviceCode()));
+    request.tag = DeviceSelectionRequest;
+    return request;
+}
+
+bool DeviceMonitor::needsSelection(quint8 slaveId) const
+{
+    // 只有主站空闲(没有排队或进行中的请求)时，记录的选择状态才能保证读取发出时仍然成立；
+    // 否则排在前面的选择写(调度器或其他设备的)可能先改掉它
+    int code = deviceCode();
+    if (code < 0) return false;
+    return m_bus->master()->pendingCount() > 0 || m_bus->scheduler()->selectedDevice(slaveId) != code;
+}
+
+void DeviceMonitor::onReplyReceived(const ModbusReply &reply)
+{
+    if (!reply.isValid()) {
+        log(LogLevel::Warning, QString("本次事务失败: %1 (共发送%2次，耗时%3ms)")
+                        .arg(reply.errorString()).arg(reply.attempts).arg(reply.elapsedMs));
+        return;
+    }
+    log(LogLevel::Debug, "CRC校验成功");
+
+    switch (reply.request.tag) {
+    case DeviceSelectionRequest:
+        log(LogLevel::Info, "设备选择成功。");
+        break;
+
+    case DataRequest: {
+        ModbusFrameView payload = reply.payload();
+        DeviceSample sample;
+        if (!decode(payload, reply.request.slaveId, &sample)) {
+            log(LogLevel::Warning, QString("数据长度不足，期望至少%1字节，实际%2字节")
+                            .arg(minimumPayloadSize()).arg(payload.size()));
+            return;
+        }
+        // 读请求的 PDU 数据为 起始地址(2) + 数量(2)，大端
+        if (reply.request.data.size() >= 4) {
+            const uchar *range = reinterpret_cast<const uchar *>(reply.request.data.constData());
+            sample.address = qFromBigEndian<quint16>(range);
+            sample.count = qFromBigEndian<quint16>(range + 2);
+        }
+        log(LogLevel::Info, describeSample(sample));
+        // 排队送到界面线程: 页面显示，WebSocketHub 推送给订阅的客户端
+        emit sampleReady(sample);
+        break;
+    }
+
+    default:
+        log(LogLevel::Warning, "警告: 收到未知请求的应答，已忽略。");
+        break;
+    }
+}
+
+QJsonObject DeviceMonitor::handleCommand(const QJsonObject &command)
+{
+    // 同时接受铁芯页面(SEND_NOW/START_AUTO)和局放/微水页面(SEND_ONCE/START_AUTO_POLL)的命令名
+    QString type = command.value("type").toString();
+
+    if (type == "SEND_ONCE" || type == "SEND_NOW") {
+        // 总线忙时由主站排队，相同的读取在 sendOnce() 中合并
+        readParametersFrom(command);
+        sendOnce();
+
+    } else if (type == "START_AUTO_POLL" || type == "START_AUTO") {
+        if (!isPortOpen()) {
+            log(LogLevel::Error, "错误: 串口未打开，无法执行指令。");
+            return QJsonObject();
+        }
+        readParametersFrom(command);
+        int interval = command.value("interval").toInt(m_intervalMs);
+        if (interval > 0) m_intervalMs = interval;
+        startPolling(command);
+        // "interval":"auto" 时取总线容量允许的最短间隔
+        if (command.value("interval").toString() == "auto") applyDensestInterval();
+        log(LogLevel::Info, "启动自动轮询，间隔: " + QString::number(m_intervalMs) + "ms");
+
+        QJsonObject response;
+        response["type"] = "AUTO_STARTED";
+        response["interval"] = m_intervalMs;
+        response["jobs"] = jobStatistics();
+        return response;
+
+    } else if (type == "STOP_AUTO") {
+        stopPolling();
+        log(LogLevel::Info, "停止自动轮询");
+        QJsonObject response;
+        response["type"] = "AUTO_STOPPED";
+        return response;
+
+    } else if (type == "SET_INTERVAL") {
+        // "interval":"auto" 时取总线容量允许的最短间隔
+        bool automatic = command.value("interval").toString() == "auto";
+        int interval = command.value("interval").toInt();
+        if (automatic ? applyDensestInterval() : interval > 0) {
+            if (!automatic) {
+                setInterval(interval);
+                log(LogLevel::Info, "设置发送间隔为: " + QString::number(interval) + "ms");
+            }
+            QJsonObject response;
+            response["type"] = "INTERVAL_SET";
+            response["interval"] = m_intervalMs;
+            response["jobs"] = jobStatistics();
+            return response;
+        }
+
+    } else if (type == "GET_STATUS") {
+        return status();
+    }
+    return QJsonObject();
+}
+
+void DeviceMonitor::readParametersFrom(const QJsonObject &command)
+{
+    if (!command.contains("slaveId") && !command.contains("address") && !command.contains("count")) return;
+
+    m_slaveId = static_cast<quint8>(command.value("slaveId").toInt(m_slaveId));
+    m_readAddress = static_cast<quint16>(command.value("address").toInt(m_readAddress));
+    m_readCount = static_cast<quint16>(command.value("count").toInt(m_readCount));
+    log(LogLevel::Info, QString("设置读取参数: 从站ID=%1, 地址=0x%2, 数量=%3")
+                    .arg(m_slaveId)
+                    .arg(QString::number(m_readAddress, 16))
+                    .arg(m_readCount));
+}
+
+QJsonObject DeviceMonitor::status() const
+{
+    QJsonObject status;
+    status["type"] = "STATUS";
+    status["interval"] = m_intervalMs;
+    status["autoSending"] = isPolling();
+    status["serialOpen"] = isPortOpen();
+    status["jobs"] = jobStatistics();
+    status["coalescedReads"] = static_cast<double>(m_coalescedReads);
+    status["lanes"] = laneStatistics();
+    status["busUtilization"] = busUtilization();
+    return status;
+}
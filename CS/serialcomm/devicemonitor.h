@@ -0,0 +1,130 @@
+#ifndef DEVICEMONITOR_H
+#define DEVICEMONITOR_H
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "modbusbus.h"
+#include "devicesample.h"
+#include "logbuffer.h"
+
+// 一类设备的采集服务(与界面无关): 占用共享总线轮询设备、解码数据，执行前端发来的命令。
+// 数据由 WebSocketHub 推送给订阅的前端；图形界面和无界面守护进程使用同一套服务，
+// 页面只负责显示和操作。
+//
+// 对象本身属于界面线程；应答过滤和解码在总线线程中进行，sampleReady() 从总线线程发出，
+// 接收方按排队连接处理。日志写入 LogBuffer，来源为 name()。
+class DeviceMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    DeviceMonitor(DeviceKind kind, quint16 webSocketPort, QObject *parent = nullptr);
+    ~DeviceMonitor();
+
+    DeviceKind kind() const { return m_kind; }
+    QString name() const { return DeviceSample::kindName(m_kind); }
+
+    // 兼容旧前端的单设备 WebSocket 端口(由 WebSocketHub 监听)，0 表示不开
+    void setWebSocketPort(quint16 port) { m_webSocketPort = port; }
+    quint16 webSocketPort() const { return m_webSocketPort; }
+
+    // 串口(按串口名与其他设备共享总线)
+    bool openPort(const QString &portName, qint32 baudRate);
+    void closePort();
+    bool isPortOpen() const;
+    QString portName() const;
+    QString errorString() const { return m_errorString; }
+
+    // 读取参数与轮询
+    void setReadParameters(quint8 slaveId, quint16 address, quint16 count);
+    quint8 slaveId() const { return m_slaveId; }
+    quint16 readAddress() const { return m_readAddress; }
+    quint16 readCount() const { return m_readCount; }
+    // 超出总线容量时按调度器策略拉长或拒绝
+    void setInterval(int ms);
+    int interval() const { return m_intervalMs; }
+    // 本设备轮询任务共用时，总线容量允许的最短间隔；未轮询或总线已满时返回 -1
+    int densestInterval() const;
+    bool applyDensestInterval();
+    // 所在总线的容量上限和超出时的策略(总线为各设备共享，最后设置的生效)
+    void setBusCapacity(double maxUtilization, ModbusPollScheduler::OverloadPolicy policy);
+    double busUtilization() const;
+    // 所在总线合并相邻读取允许的寄存器间隙，-1 表示不合并
+    void setCoalesceGap(int registers);
+    // 按命令(或配置)重建轮询任务表: 带 jobs 数组时每项一条任务，缺省字段沿用顶层参数
+    void startPolling(const QJsonObject &command = QJsonObject());
+    void stopPolling();
+    bool isPolling() const { return !m_jobIds.isEmpty(); }
+    QJsonArray jobStatistics() const;
+    // 所在总线各优先通道的排队和延迟统计
+    QJsonArray laneStatistics() const;
+    // 按当前参数读取一次
+    bool sendOnce();
+    // 向从站写入设备码选中本设备，设备无需选择时返回 false
+    bool selectDevice();
+
+    // 执行前端命令(SEND_ONCE、START_AUTO_POLL、STOP_AUTO、SET_INTERVAL、GET_STATUS 等)，
+    // 返回要回复给该前端的 JSON，无需回复时为空
+    QJsonObject handleCommand(const QJsonObject &command);
+    QJsonObject status() const;
+
+    // 推送给前端的 JSON，页面也据此显示同样的文字
+    virtual QJsonObject sampleToJson(const DeviceSample &sample) const = 0;
+
+signals:
+    void sampleReady(const DeviceSample &sample);
+    void portStateChanged(bool open);
+    void pollingStateChanged(bool polling);
+
+protected:
+    // 读数据前需写入从站选择寄存器的设备码，-1 表示无需选择
+    virtual int deviceCode() const { return -1; }
+    virtual quint8 readFunctionCode() const { return 0x03; }
+    virtual int minimumPayloadSize() const = 0;
+    virtual bool decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const = 0;
+    // 解析完成后写入日志的摘要
+    virtual QString describeSample(const DeviceSample &sample) const = 0;
+
+    void log(LogLevel level, const QString &text) const;
+    void logFrame(const QString &prefix, const QByteArray &frame) const;
+
+private:
+    // 请求类型，作为请求标记随应答带回
+    enum RequestTag {
+        DeviceSelectionRequest = 1,
+        DataRequest
+    };
+
+    void connectBus();
+    void sendRequest(const ModbusRequest &request);
+    ModbusRequest selectionRequest(quint8 slaveId) const;
+    // 读取前是否需要先写选择寄存器，在总线线程中调用
+    bool needsSelection(quint8 slaveId) const;
+    quint64 readKey(quint8 slaveId, quint16 address, quint16 count) const;
+    // 在总线线程中执行
+    void onReplyReceived(const ModbusReply &reply);
+    void readParametersFrom(const QJsonObject &command);
+
+    DeviceKind m_kind;
+    quint16 m_webSocketPort;
+
+    ModbusBus *m_bus;            // 按串口共享的总线，串口未打开时为空
+    QList<int> m_jobIds;         // 本设备在总线调度器中的轮询任务
+    // 以下三项只在总线线程中访问，用于过滤共享总线上的应答
+    QSet<int> m_busJobIds;       // 同 m_jobIds
+    QSet<quint32> m_requestIds;  // 本设备直接发出、尚未应答的请求
+    QHash<quint32, quint64> m_pendingReads; // 未应答的数据请求 -> readKey()，用于合并相同的读取
+    QString m_errorString;
+    quint64 m_coalescedReads;    // 合并掉的读取次数
+
+    int m_intervalMs;
+    quint8 m_slaveId;
+    quint16 m_readAddress;
+    quint16 m_readCount;
+};
+
+#endif // DEVICEMONITOR_H
@@ -0,0 +1,133 @@
+#include "devicesample.h"
+#include <QDateTime>
+
+namespace {
+const DeviceField kIronCoreFields[] = {
+    { "coreCurrent", 0 },    // uA
+    { "clampCurrent", 0 },   // uA
+    { "standbyCurrent", 0 }  // uA
+};
+
+const DeviceField kPartialDischargeFields[] = {
+    { "type", 0 },
+    { "frequency", 0 },
+    { "totalCount", 0 },
+    { "amount", 2 },         // pC
+    { "strength", 0 },
+    { "hasSignal", 0 },
+    { "commStatus", 0 },
+    { "alarmStatus", 0 }
+};
+
+const DeviceField kMicroWaterFields[] = {
+    { "temperature", 2 },    // °C，有符号
+    { "pressure", 2 },       // MPa
+    { "density", 2 },
+    { "microWater", 2 },     // ppmV
+    { "dewPoint", 2 },       // °C，有符号
+    { "commStatus", 0 },
+    { "alarmStatus", 0 }
+};
+
+const double kPowersOfTen[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0 };
+
+void initSample(DeviceSample *sample, DeviceKind kind, quint8 slaveId, int valueCount)
+{
+    sample->kind = kind;
+    sample->slaveId = slaveId;
+    sample->timestampMs = QDateTime::currentMSecsSinceEpoch();
+    sample->deviceTime = 0;
+    sample->valueCount = valueCount;
+}
+}
+
+double DeviceSample::scaledValue(int index) const
+{
+    int count = 0;
+    const DeviceField *descriptors = fields(kind, &count);
+    if (index < 0 || index >= count) return 0.0;
+    return values[index] / kPowersOfTen[descriptors[index].decimals];
+}
+
+QString DeviceSample::formattedValue(int index) const
+{
+    int count = 0;
+    const DeviceField *descriptors = fields(kind, &count);
+    if (index < 0 || index >= count) return QString();
+    if (descriptors[index].decimals == 0) return QString::number(values[index]);
+    return QString::number(scaledValue(index), 'f', descriptors[index].decimals);
+}
+
+const DeviceField *DeviceSample::fields(DeviceKind kind, int *count)
+{
+    switch (kind) {
+    case DeviceKind::IronCore:
+        *count = sizeof(kIronCoreFields) / sizeof(kIronCoreFields[0]);
+        return kIronCoreFields;
+    case DeviceKind::PartialDischarge:
+        *count = sizeof(kPartialDischargeFields) / sizeof(kPartialDischargeFields[0]);
+        return kPartialDischargeFields;
+    case DeviceKind::MicroWater:
+        *count = sizeof(kMicroWaterFields) / sizeof(kMicroWaterFields[0]);
+        return kMicroWaterFields;
+    }
+    *count = 0;
+    return nullptr;
+}
+
+QString DeviceSample::kindName(DeviceKind kind)
+{
+    switch (kind) {
+    case DeviceKind::IronCore: return "ironCore";
+    case DeviceKind::PartialDischarge: return "partialDischarge";
+    case DeviceKind::MicroWater: return "microWater";
+    }
+    return QString();
+}
+
+bool DeviceSample::decodeIronCore(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample)
+{
+    // 24字节 = 6个32位寄存器 × 4字节，前三个为铁芯/夹件/备用电流(小端)
+    if (payload.size() < 24) return false;
+
+    initSample(sample, DeviceKind::IronCore, slaveId, 3);
+    sample->values[CoreCurrent] = payload.uint32LeAt(0);
+    sample->values[ClampCurrent] = payload.uint32LeAt(4);
+    sample->values[StandbyCurrent] = payload.uint32LeAt(8);
+    return true;
+}
+
+bool DeviceSample::decodePartialDischarge(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample)
+{
+    // 时间(4) 类型 频率(2+2) 总次数(4) 幅值 强度 有无信号 通讯 报警(5×2) = 22字节，大端
+    if (payload.size() < 22) return false;
+
+    initSample(sample, DeviceKind::PartialDischarge, slaveId, 8);
+    sample->deviceTime = payload.uint32At(0);
+    sample->values[PdType] = payload.uint16At(4);
+    sample->values[PdFrequency] = payload.uint16At(6);
+    sample->values[PdTotalCount] = payload.uint32At(8);
+    sample->values[PdAmount] = payload.uint16At(12);
+    sample->values[PdStrength] = payload.uint16At(14);
+    sample->values[PdHasSignal] = payload.uint16At(16);
+    sample->values[PdCommStatus] = payload.uint16At(18);
+    sample->values[PdAlarmStatus] = payload.uint16At(20);
+    return true;
+}
+
+bool DeviceSample::decodeMicroWater(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample)
+{
+    // 时间(4) + 7个16位寄存器 = 18字节，大端；温度和露点为有符号数
+    if (payload.size() < 18) return false;
+
+    initSample(sample, DeviceKind::MicroWater, slaveId, 7);
+    sample->deviceTime = payload.uint32At(0);
+    sample->values[MwTemperature] = static_cast<qint16>(payload.uint16At(4));
+    sample->values[MwPressure] = payload.uint16At(6);
+    sample->values[MwDensity] = payload.uint16At(8);
+    sample->values[MwMicroWater] = payload.uint16At(10);
+    sample->values[MwDewPoint] = static_cast<qint16>(payload.uint16At(12));
+    sample->values[MwCommStatus] = payload.uint16At(14);
+    sample->values[MwAlarmStatus] = payload.uint16At(16);
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef DEVICESAMPLE_H
+#define DEVICESAMPLE_H
+
+#include <QString>
+#include <QMetaType>
+#include "modbusframeview.h"
+
+enum class DeviceKind : quint8 {
+    IronCore = 1,         // 铁芯接地电流
+    PartialDischarge = 2, // 变压器局放
+    MicroWater = 3        // 微水
+};
+
+// 字段描述: 实际值 = 原始整数值 / 10^decimals
+struct DeviceField
+{
+    const char *key; // JSON字段名
+    int decimals;
+};
+
+// 一次采集解码后的数据。数值按寄存器原始整数保存，缩放由字段描述给出
+struct DeviceSample
+{
+    enum { MaxValues = 8 };
+
+    enum IronCoreField { CoreCurrent, ClampCurrent, StandbyCurrent };
+    enum PartialDischargeField { PdType, PdFrequency, PdTotalCount, PdAmount, PdStrength,
+                                 PdHasSignal, PdCommStatus, PdAlarmStatus };
+    enum MicroWaterField { MwTemperature, MwPressure, MwDensity, MwMicroWater, MwDewPoint,
+                           MwCommStatus, MwAlarmStatus };
+
+    DeviceKind kind = DeviceKind::IronCore;
+    quint8 slaveId = 0;
+    qint64 timestampMs = 0; // 接收时间(毫秒时间戳)
+    qint64 deviceTime = 0;  // 设备上报时间(秒)，无则为0
+    quint16 address = 0;    // 产生该样本的读取: 起始寄存器和数量(不写入磁盘日志)
+    quint16 count = 0;
+    int valueCount = 0;
+    qint64 values[MaxValues] = {};
+
+    double scaledValue(int index) const;
+    // 按字段小数位格式化，如 "23.45"
+    QString formattedValue(int index) const;
+
+    static const DeviceField *fields(DeviceKind kind, int *count);
+    static QString kindName(DeviceKind kind);
+
+    // 从读寄存器应答的数据区解码，长度不足时返回 false
+    static bool decodeIronCore(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample);
+    static bool decodePartialDischarge(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample);
+    static bool decodeMicroWater(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample);
+};
+Q_DECLARE_METATYPE(DeviceSample)
+
+#endif // DEVICESAMPLE_H
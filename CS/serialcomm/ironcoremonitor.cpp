@@ -0,0 +1,31 @@
+#include "ironcoremonitor.h"
+
+IronCoreMonitor::IronCoreMonitor(QObject *parent) :
+    DeviceMonitor(DeviceKind::IronCore, 8080, parent)
+{
+    // 根据协议示例，读取从0x0000开始的0x000C个寄存器
+    setReadParameters(0x01, 0x0000, 0x000C);
+}
+
+QJsonObject IronCoreMonitor::sampleToJson(const DeviceSample &sample) const
+{
+    QJsonObject json;
+    json["coreCurrent"] = sample.values[DeviceSample::CoreCurrent];
+    json["clampCurrent"] = sample.values[DeviceSample::ClampCurrent];
+    json["standbyCurrent"] = sample.values[DeviceSample::StandbyCurrent];
+    json["slaveId"] = sample.slaveId;
+    return json;
+}
+
+bool IronCoreMonitor::decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const
+{
+    return DeviceSample::decodeIronCore(payload, slaveId, sample);
+}
+
+QString IronCoreMonitor::describeSample(const DeviceSample &sample) const
+{
+    return QString("解析结果: 铁芯电流=%1uA, 夹件电流=%2uA, 备用电流=%3uA")
+            .arg(sample.values[DeviceSample::CoreCurrent])
+            .arg(sample.values[DeviceSample::ClampCurrent])
+            .arg(sample.values[DeviceSample::StandbyCurrent]);
+}
@@ -0,0 +1,23 @@
+#ifndef IRONCOREMONITOR_H
+#define IRONCOREMONITOR_H
+
+#include "devicemonitor.h"
+
+// 铁芯接地电流: 读输入寄存器，无需设备选择。WebSocket 默认端口 8080
+class IronCoreMonitor : public DeviceMonitor
+{
+    Q_OBJECT
+
+public:
+    explicit IronCoreMonitor(QObject *parent = nullptr);
+
+    QJsonObject sampleToJson(const DeviceSample &sample) const override;
+
+protected:
+    quint8 readFunctionCode() const override { return 0x04; }
+    int minimumPayloadSize() const override { return 24; }
+    bool decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const override;
+    QString describeSample(const DeviceSample &sample) const override;
+};
+
+#endif // IRONCOREMONITOR_H
@@ -0,0 +1,217 @@
+#include "logbuffer.h"
+#include <QThread>
+#include <QQueue>
+#include <QWaitCondition>
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <cstdio>
+
+namespace {
+const int kMaxPendingWrites = 10000; // 写盘跟不上时最多积压的条数
+}
+
+QString LogEntry::toString() const
+{
+    QString line = QDateTime::fromMSecsSinceEpoch(timestampMs).toString("[yyyy-MM-dd hh:mm:ss.zzz] ") + text;
+    if (!frame.isEmpty()) line += frame.toHex(' ').toUpper();
+    return line;
+}
+
+QString LogEntry::toLogLine() const
+{
+    QString line = QDateTime::fromMSecsSinceEpoch(timestampMs).toString("yyyy-MM-dd hh:mm:ss.zzz")
+            + " [" + LogBuffer::levelName(level) + "] [" + source + "] " + text;
+    if (!frame.isEmpty()) line += frame.toHex(' ').toUpper();
+    return line;
+}
+
+// 文件输出线程: 日志排队，格式化和写盘都在本线程进行
+class LogFileWriter : public QThread
+{
+public:
+    explicit LogFileWriter(QFile *file) :
+        m_file(file),
+        m_dropped(0),
+        m_stopping(false)
+    {
+        setObjectName("LogFileWriter");
+    }
+
+    ~LogFileWriter()
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopping = true;
+            m_condition.wakeOne();
+        }
+        wait();
+        delete m_file;
+    }
+
+    void enqueue(const LogEntry &entry)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.size() >= kMaxPendingWrites) {
+            ++m_dropped;
+            return;
+        }
+        m_queue.enqueue(entry);
+        m_condition.wakeOne();
+    }
+
+protected:
+    void run() override
+    {
+        QTextStream stream(m_file);
+        stream.setCodec("UTF-8");
+        for (;;) {
+            QQueue<LogEntry> batch;
+            quint64 dropped = 0;
+            bool stopping = false;
+            {
+                QMutexLocker locker(&m_mutex);
+                while (m_queue.isEmpty() && !m_stopping) m_condition.wait(&m_mutex);
+                batch.swap(m_queue);
+                dropped = m_dropped;
+                m_dropped = 0;
+                stopping = m_stopping;
+            }
+            for (const LogEntry &entry : qAsConst(batch)) {
+                stream << entry.toLogLine() << '\n';
+            }
+            if (dropped > 0) stream << "写日志跟不上，丢弃 " << dropped << " 条\n";
+            stream.flush();
+            if (stopping) return;
+        }
+    }
+
+private:
+    QFile *m_file;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<LogEntry> m_queue;
+    quint64 m_dropped;
+    bool m_stopping;
+};
+
+LogBuffer::LogBuffer(int capacity) :
+    m_entries(qMax(1, capacity)),
+    m_nextSequence(1),
+    m_minimumLevel(static_cast<int>(LogLevel::Frame)),
+    m_writer(nullptr)
+{
+}
+
+LogBuffer::~LogBuffer()
+{
+    delete m_writer;
+}
+
+LogBuffer *LogBuffer::instance()
+{
+    static LogBuffer buffer;
+    return &buffer;
+}
+
+void LogBuffer::setCapacity(int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries = QVector<LogEntry>(qMax(1, capacity));
+}
+
+int LogBuffer::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+void LogBuffer::append(LogLevel level, const QString &source, const QString &text, const QByteArray &frame)
+{
+    if (!isEnabled(level)) return;
+
+    QMutexLocker locker(&m_mutex);
+    LogEntry &entry = m_entries[static_cast<int>(m_nextSequence % m_entries.size())];
+    entry.sequence = m_nextSequence++;
+    entry.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    entry.level = level;
+    entry.source = source;
+    entry.text = text;
+    entry.frame = frame;
+    if (m_writer) m_writer->enqueue(entry);
+}
+
+QList<LogEntry> LogBuffer::entriesAfter(quint64 *sequence, const QString &source, int maxCount) const
+{
+    QList<LogEntry> result;
+    QMutexLocker locker(&m_mutex);
+    quint64 capacity = static_cast<quint64>(m_entries.size());
+    quint64 oldest = m_nextSequence > capacity ? m_nextSequence - capacity : 1;
+    quint64 first = qMax(*sequence + 1, oldest);
+
+    // 从最新往回取，够 maxCount 条即停
+    for (quint64 seq = m_nextSequence; seq > first && result.size() < maxCount; --seq) {
+        const LogEntry &entry = m_entries.at(static_cast<int>((seq - 1) % capacity));
+        if (entry.sequence != seq - 1) break; // 修改容量后尚未写到的位置
+        if (source.isEmpty() || entry.source == source) result.prepend(entry);
+    }
+    *sequence = m_nextSequence - 1;
+    return result;
+}
+
+quint64 LogBuffer::lastSequence() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_nextSequence - 1;
+}
+
+bool LogBuffer::setFileSink(const QString &path, QString *errorString)
+{
+    QFile *file = nullptr;
+    if (!path.isEmpty()) {
+        file = new QFile(path == "-" ? QString() : path);
+        bool opened = path == "-"
+                ? file->open(stdout, QIODevice::WriteOnly | QIODevice::Text)
+                : file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+        if (!opened) {
+            if (errorString) *errorString = QString("无法打开日志文件 %1: %2").arg(path, file->errorString());
+            delete file;
+            return false;
+        }
+    }
+
+    LogFileWriter *writer = file ? new LogFileWriter(file) : nullptr;
+    if (writer) writer->start(QThread::LowPriority);
+
+    LogFileWriter *previous;
+    {
+        QMutexLocker locker(&m_mutex);
+        previous = m_writer;
+        m_writer = writer;
+    }
+    delete previous; // 写完积压的日志后结束
+    return true;
+}
+
+QString LogBuffer::levelName(LogLevel level)
+{
+    switch (level) {
+    case LogLevel::Frame: return "frame";
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    }
+    return QString();
+}
+
+bool LogBuffer::levelFromName(const QString &name, LogLevel *level)
+{
+    for (int i = static_cast<int>(LogLevel::Frame); i <= static_cast<int>(LogLevel::Error); ++i) {
+        if (levelName(static_cast<LogLevel>(i)) == name) {
+            *level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
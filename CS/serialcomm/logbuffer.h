@@ -0,0 +1,82 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <climits>
+
+enum class LogLevel : int {
+    Frame = 0, // 收发报文
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+struct LogEntry
+{
+    quint64 sequence = 0;
+    qint64 timestampMs = 0;
+    LogLevel level = LogLevel::Info;
+    QString source;   // 来源设备，如 "partialDischarge"
+    QString text;
+    QByteArray frame; // 报文原始字节，显示时才转成十六进制
+
+    // 显示用: "[时间] 文字 报文"
+    QString toString() const;
+    // 写文件用: 另带来源和级别
+    QString toLogLine() const;
+};
+
+class LogFileWriter;
+
+// 进程内的日志环形缓冲: 固定条数，写满后覆盖最旧的。
+// 任何线程都可写入；报文只保存原始字节，十六进制在页面显示或写文件时才生成，
+// 级别低于 minimumLevel() 的日志在写入前即被丢弃(关闭报文日志时收发路径上不做任何复制)。
+// 页面定时取出自己上次读到之后的若干条显示；可选的文件输出在单独线程中写盘。
+class LogBuffer
+{
+public:
+    enum { DefaultCapacity = 5000 };
+
+    explicit LogBuffer(int capacity = DefaultCapacity);
+    ~LogBuffer();
+
+    static LogBuffer *instance();
+
+    // 修改容量会清空已有日志
+    void setCapacity(int capacity);
+    int capacity() const;
+
+    void setMinimumLevel(LogLevel level) { m_minimumLevel.store(static_cast<int>(level)); }
+    LogLevel minimumLevel() const { return static_cast<LogLevel>(m_minimumLevel.load()); }
+    bool isEnabled(LogLevel level) const { return static_cast<int>(level) >= m_minimumLevel.load(); }
+
+    void append(LogLevel level, const QString &source, const QString &text,
+                const QByteArray &frame = QByteArray());
+
+    // 取 *sequence 之后的日志(source 为空时不按来源过滤)，最多取最新的 maxCount 条，
+    // 并把 *sequence 推进到最新。读得太慢被覆盖的日志直接跳过
+    QList<LogEntry> entriesAfter(quint64 *sequence, const QString &source = QString(),
+                                 int maxCount = INT_MAX) const;
+    quint64 lastSequence() const;
+
+    // 同时写入文件，path 为 "-" 时写标准输出，为空时关闭文件输出
+    bool setFileSink(const QString &path, QString *errorString = nullptr);
+
+    static QString levelName(LogLevel level);
+    static bool levelFromName(const QString &name, LogLevel *level);
+
+private:
+    mutable QMutex m_mutex;
+    QVector<LogEntry> m_entries;
+    quint64 m_nextSequence;
+    QAtomicInt m_minimumLevel;
+    LogFileWriter *m_writer;
+};
+
+#endif // LOGBUFFER_H
@@ -1,11 +1,81 @@
+#include "acquisitionengine.h"
+#include <QCoreApplication>
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QDebug>
+#ifndef SERIALCOMM_HEADLESS
 #include "mainwindow.h"
 #include <QApplication>
+#endif
+
+namespace {
+
+#ifndef SERIALCOMM_HEADLESS
+// QApplication 创建前需要判断是否以无界面方式运行
+bool hasArgument(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+#endif
+
+// 解析命令行并加载配置文件，失败时返回 false
+bool configure(const QCoreApplication &app, AcquisitionEngine *engine)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("设备监测采集服务");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("headless", "不显示界面，作为后台服务运行"));
+    parser.addOption(QCommandLineOption({"c", "config"}, "配置文件(JSON)", "file"));
+    parser.process(app);
+
+    QString configPath = parser.value("config");
+    if (configPath.isEmpty()) return true;
+
+    QString error;
+    if (!engine->loadConfig(configPath, &error)) {
+        qCritical().noquote() << error;
+        return false;
+    }
+    return true;
+}
+
+int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // 无界面运行时日志默认写标准输出、不记录报文，配置文件中的 log 项可另行指定
+    LogBuffer::instance()->setMinimumLevel(LogLevel::Info);
+    LogBuffer::instance()->setFileSink("-");
+
+    AcquisitionEngine engine;
+    if (!configure(app, &engine)) return 1;
+
+    if (engine.start() > 0) {
+        qWarning().noquote() << "部分设备启动失败，见上方日志";
+    }
+    return app.exec();
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
+#ifdef SERIALCOMM_HEADLESS
+    return runHeadless(argc, argv);
+#else
+    if (hasArgument(argc, argv, "--headless")) return runHeadless(argc, argv);
+
     QApplication a(argc, argv);
-    MainWindow w;
+    AcquisitionEngine engine;
+    if (!configure(a, &engine)) return 1;
+
+    // 页面先连上日志信号，再启动引擎，启动日志才能显示在界面上
+    MainWindow w(&engine);
+    engine.start();
     w.show();
 
     return a.exec();
+#endif
 }
@@ -4,7 +4,7 @@
 #include <QVBoxLayout>
 #include <QLabel>
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(AcquisitionEngine *engine, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
@@ -46,10 +46,10 @@ MainWindow::MainWindow(QWidget *parent)
 
 
     // --- 创建各个功能页面 ---
-    serialCommWidget = new Widget();
+    serialCommWidget = new Widget(engine->ironCore());
     // 修改: 创建新页面实例
-    partialDischargeWidget = new PartialDischargeWidget();
-    microWaterWidget = new MicroWaterWidget();
+    partialDischargeWidget = new PartialDischargeWidget(engine->partialDischarge());
+    microWaterWidget = new MicroWaterWidget(engine->microWater());
 
     // --- 将所有页面添加到堆叠窗口 ---
     stackedWidget->addWidget(homePage);
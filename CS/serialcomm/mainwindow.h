@@ -7,6 +7,7 @@
 // 新增: 包含新页面的头文件
 #include "partialdischargewidget.h"
 #include "microwaterwidget.h"
+#include "acquisitionengine.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -19,7 +20,8 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    // 各页面显示 engine 中对应设备的采集服务
+    explicit MainWindow(AcquisitionEngine *engine, QWidget *parent = nullptr);
     ~MainWindow();
 
 private slots:
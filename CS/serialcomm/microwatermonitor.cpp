@@ -0,0 +1,49 @@
+#include "microwatermonitor.h"
+#include <QDateTime>
+
+MicroWaterMonitor::MicroWaterMonitor(QObject *parent) :
+    DeviceMonitor(DeviceKind::MicroWater, 8082, parent)
+{
+    // 读取地址和数量由Web端或配置文件给出
+    setReadParameters(1, 0, 0);
+}
+
+QJsonObject MicroWaterMonitor::sampleToJson(const DeviceSample &sample) const
+{
+    // 数值按字段小数位格式化为字符串(原始值除以100)，状态保持整数
+    QJsonObject json;
+    json["slaveId"] = sample.slaveId;
+    json["time"] = QDateTime::fromSecsSinceEpoch(sample.deviceTime).toString("yyyy-MM-dd hh:mm:ss");
+    json["temperature"] = sample.formattedValue(DeviceSample::MwTemperature);
+    json["pressure"] = sample.formattedValue(DeviceSample::MwPressure);
+    json["density"] = sample.formattedValue(DeviceSample::MwDensity);
+    json["microWater"] = sample.formattedValue(DeviceSample::MwMicroWater);
+    json["dewPoint"] = sample.formattedValue(DeviceSample::MwDewPoint);
+    json["commStatus"] = static_cast<int>(sample.values[DeviceSample::MwCommStatus]);
+    json["alarmStatus"] = static_cast<int>(sample.values[DeviceSample::MwAlarmStatus]);
+    return json;
+}
+
+QString MicroWaterMonitor::commStatusText(int status)
+{
+    return status == 0 ? "正常" : (status == 1 ? "异常" : "初始化状态");
+}
+
+QString MicroWaterMonitor::alarmStatusText(int status)
+{
+    return status == 0 ? "正常" : (status == 1 ? "预警" : "报警");
+}
+
+bool MicroWaterMonitor::decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const
+{
+    return DeviceSample::decodeMicroWater(payload, slaveId, sample);
+}
+
+QString MicroWaterMonitor::describeSample(const DeviceSample &sample) const
+{
+    return QString("微水数据解析完成 - 时间:%1, 温度:%2°C, 压力:%3MPa, 微水:%4ppmV")
+            .arg(QDateTime::fromSecsSinceEpoch(sample.deviceTime).toString("yyyy-MM-dd hh:mm:ss"))
+            .arg(sample.formattedValue(DeviceSample::MwTemperature))
+            .arg(sample.formattedValue(DeviceSample::MwPressure))
+            .arg(sample.formattedValue(DeviceSample::MwMicroWater));
+}
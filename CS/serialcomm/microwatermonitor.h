@@ -0,0 +1,27 @@
+#ifndef MICROWATERMONITOR_H
+#define MICROWATERMONITOR_H
+
+#include "devicemonitor.h"
+
+// 微水: 读保持寄存器前写入设备码 0x520b 选中设备。WebSocket 默认端口 8082
+class MicroWaterMonitor : public DeviceMonitor
+{
+    Q_OBJECT
+
+public:
+    explicit MicroWaterMonitor(QObject *parent = nullptr);
+
+    QJsonObject sampleToJson(const DeviceSample &sample) const override;
+
+    // 通讯/报警状态的显示文字
+    static QString commStatusText(int status);
+    static QString alarmStatusText(int status);
+
+protected:
+    int deviceCode() const override { return 0x520b; }
+    int minimumPayloadSize() const override { return 18; }
+    bool decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const override;
+    QString describeSample(const DeviceSample &sample) const override;
+};
+
+#endif // MICROWATERMONITOR_H
@@ -0,0 +1,72 @@
+#include "modbusbus.h"
+#include <QCoreApplication>
+
+QHash<QString, ModbusBus *> ModbusBus::s_buses;
+
+ModbusBus::ModbusBus(const QString &portName) :
+    QObject(nullptr),
+    m_portName(portName),
+    m_thread(new QThread),
+    m_master(new ModbusRtuMaster(this)),
+    m_scheduler(new ModbusPollScheduler(m_master, this)),
+    m_baudRate(0),
+    m_refCount(0)
+{
+    // 主站和调度器是子对象，随总线一起移入总线线程
+    m_thread->setObjectName("ModbusBus " + portName);
+    moveToThread(m_thread);
+    m_thread->start(QThread::HighPriority);
+}
+
+ModbusBus::~ModbusBus()
+{
+    delete m_thread;
+}
+
+ModbusBus *ModbusBus::acquire(const QString &portName, qint32 baudRate, QString *errorString)
+{
+    ModbusBus *bus = s_buses.value(portName);
+    if (!bus) {
+        bus = new ModbusBus(portName);
+        QString error;
+        bool opened = bus->evaluate([bus, portName, baudRate, &error] {
+            if (!bus->m_master->open(portName, baudRate)) {
+                error = bus->m_master->errorString();
+                return false;
+            }
+            bus->m_scheduler->start();
+            return true;
+        });
+        if (!opened) {
+            if (errorString) *errorString = error;
+            bus->shutdown();
+            delete bus;
+            return nullptr;
+        }
+        bus->m_baudRate = baudRate;
+        s_buses.insert(portName, bus);
+    }
+    ++bus->m_refCount;
+    return bus;
+}
+
+void ModbusBus::release(ModbusBus *bus)
+{
+    if (!bus || --bus->m_refCount > 0) return;
+    s_buses.remove(bus->m_portName);
+    bus->shutdown();
+    delete bus;
+}
+
+void ModbusBus::shutdown()
+{
+    QThread *mainThread = QCoreApplication::instance()->thread();
+    run([this, mainThread] {
+        m_scheduler->stop();
+        m_master->close();
+        // 定时器和串口须在所属线程中停止；停止后移回主线程再销毁
+        moveToThread(mainThread);
+    });
+    m_thread->quit();
+    m_thread->wait();
+}
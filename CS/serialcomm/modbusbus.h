@@ -0,0 +1,73 @@
+#ifndef MODBUSBUS_H
+#define MODBUSBUS_H
+
+#include <QObject>
+#include <QHash>
+#include <QThread>
+#include "modbusrtumaster.h"
+#include "modbuspollscheduler.h"
+
+// 按串口名共享的一条 RS-485 总线: 一个主站加一个轮询调度器。
+// 局放和微水页面接在同一网关上时拿到的是同一个对象，请求经同一调度器排队，
+// 设备选择状态也只记录一份，不会互相打断或重复切换。
+//
+// 每条总线有自己的线程，串口收发、CRC校验、超时重发和轮询调度都在该线程中进行，
+// 不受界面绘制和日志刷新影响。主站和调度器只能在总线线程中访问: 其他线程通过
+// run()/evaluate() 把操作交给总线线程执行；连接带帧视图的信号(replyReceived、
+// frameReceived、jobReplied)须用 Qt::DirectConnection，槽在总线线程中执行，
+// 只应解码后把结果以排队信号送出。
+class ModbusBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 取得指定串口的总线，首次取得时以 baudRate 打开串口；失败返回 nullptr 并给出原因。
+    // 串口已被其他页面以不同波特率打开时沿用已有设置。与 release() 成对调用
+    static ModbusBus *acquire(const QString &portName, qint32 baudRate, QString *errorString = nullptr);
+    // 最后一个使用者释放时关闭串口、结束线程并销毁
+    static void release(ModbusBus *bus);
+
+    ModbusRtuMaster *master() const { return m_master; }
+    ModbusPollScheduler *scheduler() const { return m_scheduler; }
+    QString portName() const { return m_portName; }
+    qint32 baudRate() const { return m_baudRate; }
+    int userCount() const { return m_refCount; }
+
+    // 在总线线程中执行 function 并等待其完成；已在总线线程中时直接调用
+    template <typename Function>
+    void run(Function function) const
+    {
+        if (QThread::currentThread() == m_thread) {
+            function();
+        } else {
+            QMetaObject::invokeMethod(m_master, function, Qt::BlockingQueuedConnection);
+        }
+    }
+
+    // 同 run()，返回 function 的结果
+    template <typename Function>
+    auto evaluate(Function function) const -> decltype(function())
+    {
+        decltype(function()) result{};
+        run([&result, &function] { result = function(); });
+        return result;
+    }
+
+private:
+    explicit ModbusBus(const QString &portName);
+    ~ModbusBus();
+
+    // 关闭串口、停止调度并结束总线线程
+    void shutdown();
+
+    static QHash<QString, ModbusBus *> s_buses;
+
+    QString m_portName;
+    QThread *m_thread;
+    ModbusRtuMaster *m_master;
+    ModbusPollScheduler *m_scheduler;
+    qint32 m_baudRate;
+    int m_refCount;
+};
+
+#endif // MODBUSBUS_H
@@ -0,0 +1,82 @@
+#include "modbuscrc.h"
+
+namespace {
+struct CrcTables
+{
+    quint16 table[8][256];
+};
+
+// 编译期生成查找表: table[0] 为标准单表，table[k] 为在其后再移入 k 个零字节的结果
+constexpr CrcTables makeTables()
+{
+    CrcTables tables{};
+    for (int i = 0; i < 256; ++i) {
+        quint16 crc = static_cast<quint16>(i);
+        for (int j = 0; j < 8; ++j) {
+            crc = (crc & 0x0001) ? static_cast<quint16>((crc >> 1) ^ 0xA001)
+                                 : static_cast<quint16>(crc >> 1);
+        }
+        tables.table[0][i] = crc;
+    }
+    for (int k = 1; k < 8; ++k) {
+        for (int i = 0; i < 256; ++i) {
+            quint16 prev = tables.table[k - 1][i];
+            tables.table[k][i] = static_cast<quint16>((prev >> 8) ^ tables.table[0][prev & 0xFF]);
+        }
+    }
+    return tables;
+}
+
+constexpr CrcTables kTables = makeTables();
+
+static_assert(kTables.table[0][1] == 0xC0C1, "CRC-16/Modbus table mismatch");
+static_assert(kTables.table[0][255] == 0x4040, "CRC-16/Modbus table mismatch");
+}
+
+quint16 ModbusCrc::calculate(const char *data, int length)
+{
+    return update(InitialValue, data, length);
+}
+
+quint16 ModbusCrc::update(quint16 crc, const char *data, int length)
+{
+    // 不足8字节的部分 slicing 内核会退回单表逐字节计算
+    return updateSlicing8(crc, data, length);
+}
+
+quint16 ModbusCrc::updateByte(quint16 crc, quint8 byte)
+{
+    return static_cast<quint16>((crc >> 8) ^ kTables.table[0][(crc ^ byte) & 0xFF]);
+}
+
+quint16 ModbusCrc::updateBytewise(quint16 crc, const char *data, int length)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    for (int i = 0; i < length; ++i) {
+        crc = static_cast<quint16>((crc >> 8) ^ kTables.table[0][(crc ^ p[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+quint16 ModbusCrc::updateSlicing8(quint16 crc, const char *data, int length)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    const auto &t = kTables.table;
+
+    // 每次处理8字节: CRC只有16位，只影响前两个字节的查表下标
+    while (length >= 8) {
+        crc = t[7][p[0] ^ (crc & 0xFF)] ^ t[6][p[1] ^ (crc >> 8)] ^
+              t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        p += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = static_cast<quint16>((crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF]);
+    }
+    return crc;
+}
+
+bool ModbusCrc::checkFrame(const char *frame, int length)
+{
+    return length >= 2 && calculate(frame, length) == 0;
+}
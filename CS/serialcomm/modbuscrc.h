@@ -0,0 +1,37 @@
+#ifndef MODBUSCRC_H
+#define MODBUSCRC_H
+
+#include <QtGlobal>
+
+// CRC-16/Modbus (多项式 0xA001 反射, 初值 0xFFFF)
+// 查表实现，长数据块使用 slicing-by-8；支持按字节到达增量计算。
+// 对 "数据 + CRC低字节 + CRC高字节" 整体计算的结果为 0，可直接用于校验整帧。
+class ModbusCrc
+{
+public:
+    static const quint16 InitialValue = 0xFFFF;
+
+    ModbusCrc() : m_crc(InitialValue) {}
+
+    void reset() { m_crc = InitialValue; }
+    void addData(const char *data, int length) { m_crc = update(m_crc, data, length); }
+    void addByte(quint8 byte) { m_crc = updateByte(m_crc, byte); }
+    quint16 value() const { return m_crc; }
+
+    // 整块计算，使用 slicing-by-8 内核
+    static quint16 calculate(const char *data, int length);
+    static quint16 update(quint16 crc, const char *data, int length);
+    static quint16 updateByte(quint16 crc, quint8 byte);
+
+    // 单表逐字节 / slicing-by-8 两种内核，供基准测试对比
+    static quint16 updateBytewise(quint16 crc, const char *data, int length);
+    static quint16 updateSlicing8(quint16 crc, const char *data, int length);
+
+    // 帧末两字节为低字节在前的CRC时，校验整帧
+    static bool checkFrame(const char *frame, int length);
+
+private:
+    quint16 m_crc;
+};
+
+#endif // MODBUSCRC_H
@@ -0,0 +1,59 @@
+#ifndef MODBUSFRAMEVIEW_H
+#define MODBUSFRAMEVIEW_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// 指向接收缓冲区中一段连续字节的只读视图，不拥有数据。
+// 仅在产生它的信号/调用期间有效，需要保留时用 toByteArray() 复制。
+class ModbusFrameView
+{
+public:
+    ModbusFrameView() : m_data(nullptr), m_size(0) {}
+    ModbusFrameView(const char *data, int size)
+        : m_data(reinterpret_cast<const uchar *>(data)), m_size(size) {}
+    explicit ModbusFrameView(const QByteArray &bytes)
+        : m_data(reinterpret_cast<const uchar *>(bytes.constData())), m_size(bytes.size()) {}
+
+    const char *data() const { return reinterpret_cast<const char *>(m_data); }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    quint8 at(int i) const { return m_data[i]; }
+    quint8 operator[](int i) const { return m_data[i]; }
+
+    // 大端(Modbus寄存器字节序)读取
+    quint16 uint16At(int offset) const
+    {
+        return static_cast<quint16>((m_data[offset] << 8) | m_data[offset + 1]);
+    }
+    quint32 uint32At(int offset) const
+    {
+        return (static_cast<quint32>(uint16At(offset)) << 16) | uint16At(offset + 2);
+    }
+    // 小端读取(铁芯接地装置的32位电流值)
+    quint32 uint32LeAt(int offset) const
+    {
+        return static_cast<quint32>(m_data[offset]) |
+               (static_cast<quint32>(m_data[offset + 1]) << 8) |
+               (static_cast<quint32>(m_data[offset + 2]) << 16) |
+               (static_cast<quint32>(m_data[offset + 3]) << 24);
+    }
+
+    ModbusFrameView mid(int offset, int length) const
+    {
+        offset = qBound(0, offset, m_size);
+        length = qBound(0, length, m_size - offset);
+        return ModbusFrameView(data() + offset, length);
+    }
+
+    // 不复制数据的 QByteArray 包装，生命周期同视图
+    QByteArray rawByteArray() const { return QByteArray::fromRawData(data(), m_size); }
+    QByteArray toByteArray() const { return QByteArray(data(), m_size); }
+
+private:
+    const uchar *m_data;
+    int m_size;
+};
+
+#endif // MODBUSFRAMEVIEW_H
@@ -0,0 +1,613 @@
+#include "modbuspollscheduler.h"
+#include <QTimer>
+#include <QDateTime>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace {
+const double kIntervalSmoothing = 0.2; // 发送间隔滑动平均的新样本权重
+const int kPortClosedRetryMs = 1000;
+const int kLaneFullRetryMs = 100; // 主站通道已满时稍后重试调度
+const quint16 kDefaultSelectionRegister = 0x0001;
+const double kDefaultMaxUtilization = 0.8;
+const int kMaxReadRegisters = 125; // 功能码 0x03/0x04 单次最多读取的寄存器数
+}
+
+void ModbusPollJobStatistics::addJitter(qint64 latenessMs)
+{
+    qint32 value = static_cast<qint32>(qMin<qint64>(latenessMs, std::numeric_limits<qint32>::max()));
+    if (recentJitterMs.size() < JitterWindow) {
+        recentJitterMs.append(value);
+    } else {
+        recentJitterMs[jitterCursor] = value;
+        jitterCursor = (jitterCursor + 1) % JitterWindow;
+    }
+}
+
+qint64 ModbusPollJobStatistics::jitterPercentile(double fraction) const
+{
+    if (recentJitterMs.isEmpty()) return 0;
+    QVector<qint32> sorted = recentJitterMs;
+    int index = qBound(0, static_cast<int>(fraction * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted.at(index);
+}
+
+ModbusRequest ModbusPollJob::toRequest() const
+{
+    ModbusRequest request;
+    switch (functionCode) {
+    case 0x04:
+        request = ModbusRequest::readInputRegisters(slaveId, address, count);
+        break;
+    default:
+        request = ModbusRequest::readHoldingRegisters(slaveId, address, count);
+        break;
+    }
+    request.tag = tag;
+    request.lane = ModbusRequest::PeriodicLane;
+    return request;
+}
+
+ModbusPollJob ModbusPollJob::fromJson(const QJsonObject &object, const ModbusPollJob &defaults)
+{
+    ModbusPollJob job = defaults;
+    job.slaveId = static_cast<quint8>(object.value("slaveId").toInt(defaults.slaveId));
+    job.functionCode = static_cast<quint8>(object.value("functionCode").toInt(defaults.functionCode));
+    job.address = static_cast<quint16>(object.value("address").toInt(defaults.address));
+    job.count = static_cast<quint16>(object.value("count").toInt(defaults.count));
+    job.periodMs = object.value("interval").toInt(defaults.periodMs);
+    job.phaseMs = object.value("phase").toInt(defaults.phaseMs);
+    job.priority = object.value("priority").toInt(defaults.priority);
+    job.selectionCode = object.value("selectionCode").toInt(defaults.selectionCode);
+    return job;
+}
+
+QJsonObject ModbusPollJob::toJson() const
+{
+    QJsonObject object;
+    object["id"] = id;
+    object["slaveId"] = slaveId;
+    object["functionCode"] = functionCode;
+    object["address"] = address;
+    object["count"] = count;
+    object["interval"] = periodMs;
+    if (phaseMs != 0) object["phase"] = phaseMs;
+    object["priority"] = priority;
+    if (selectionCode >= 0) object["selectionCode"] = selectionCode;
+    return object;
+}
+
+ModbusPollScheduler::ModbusPollScheduler(ModbusRtuMaster *master, QObject *parent) :
+    QObject(parent),
+    m_master(master),
+    m_timer(new QTimer(this)),
+    m_running(false),
+    m_nextJobId(1),
+    m_outstandingJobId(0),
+    m_outstandingId(0),
+    m_outstandingSelectionId(0),
+    m_blockAddress(0),
+    m_blockCount(0),
+    m_maxUtilization(kDefaultMaxUtilization),
+    m_overloadPolicy(StretchOverload),
+    m_maxCoalesceGap(0),
+    m_coalescedReads(0),
+    m_selectionRegister(kDefaultSelectionRegister),
+    m_selectionWrites(0),
+    m_selectionsSkipped(0)
+{
+    m_clock.start();
+    m_wallOffsetMs = QDateTime::currentMSecsSinceEpoch() - m_clock.elapsed();
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &ModbusPollScheduler::dispatch);
+
+    // 任何事务结束(包括页面自己发的请求)都意味着总线可能空闲了
+    connect(m_master, &ModbusRtuMaster::replyReceived, this, &ModbusPollScheduler::onReplyReceived);
+}
+
+int ModbusPollScheduler::addJob(const ModbusPollJob &job)
+{
+    JobEntry entry;
+    entry.job = job;
+    entry.job.id = m_nextJobId++;
+    int periodMs = feasiblePeriod(entry.job, qMax(1, job.periodMs));
+    if (periodMs < 0) return 0;
+    entry.job.periodMs = periodMs;
+    if (periodMs != qMax(1, job.periodMs)) emit periodAdjusted(entry.job.id, job.periodMs, periodMs);
+    entry.nextDueMs = m_clock.elapsed();
+    entry.aligned = false;
+    entry.coalesce = true;
+    m_entries.append(entry);
+
+    if (m_running) dispatch();
+    return entry.job.id;
+}
+
+bool ModbusPollScheduler::removeJob(int jobId)
+{
+    int index = indexOfJob(jobId);
+    if (index < 0) return false;
+    m_entries.removeAt(index);
+    return true;
+}
+
+void ModbusPollScheduler::clearJobs()
+{
+    m_entries.clear();
+    m_timer->stop();
+}
+
+bool ModbusPollScheduler::setJobPeriod(int jobId, int periodMs)
+{
+    int index = indexOfJob(jobId);
+    if (index < 0 || periodMs <= 0) return false;
+    int feasible = feasiblePeriod(m_entries.at(index).job, periodMs);
+    if (feasible < 0) return false;
+    if (feasible != periodMs) emit periodAdjusted(jobId, periodMs, feasible);
+    m_entries[index].job.periodMs = feasible;
+    m_entries[index].aligned = false; // 下次发送后按新周期重新对齐
+    return true;
+}
+
+void ModbusPollScheduler::setAllPeriods(int periodMs)
+{
+    if (periodMs <= 0) return;
+    QList<int> jobIds;
+    for (const JobEntry &entry : qAsConst(m_entries)) jobIds.append(entry.job.id);
+    // 所有任务一起改，按整组可行的最短周期拉长
+    int densest = densestPeriodMs(jobIds);
+    if (densest > periodMs) {
+        if (m_overloadPolicy == RejectOverload) return;
+        for (int jobId : qAsConst(jobIds)) emit periodAdjusted(jobId, periodMs, densest);
+        periodMs = densest;
+    }
+    for (JobEntry &entry : m_entries) {
+        entry.job.periodMs = periodMs;
+        entry.aligned = false;
+    }
+}
+
+void ModbusPollScheduler::setMaxCoalesceGap(int registers)
+{
+    m_maxCoalesceGap = registers;
+    // 新的间隙设置下重新尝试合并
+    for (JobEntry &entry : m_entries) entry.coalesce = true;
+}
+
+int ModbusPollScheduler::maxCoalesceGap() const
+{
+    return m_maxCoalesceGap;
+}
+
+quint64 ModbusPollScheduler::coalescedReads() const
+{
+    return m_coalescedReads;
+}
+
+void ModbusPollScheduler::setMaxUtilization(double fraction)
+{
+    m_maxUtilization = qBound(0.05, fraction, 1.0);
+}
+
+double ModbusPollScheduler::maxUtilization() const
+{
+    return m_maxUtilization;
+}
+
+void ModbusPollScheduler::setOverloadPolicy(OverloadPolicy policy)
+{
+    m_overloadPolicy = policy;
+}
+
+ModbusPollScheduler::OverloadPolicy ModbusPollScheduler::overloadPolicy() const
+{
+    return m_overloadPolicy;
+}
+
+double ModbusPollScheduler::jobAirtimeMs(const ModbusPollJob &job) const
+{
+    return jobAirtimeMs(job, nullptr);
+}
+
+double ModbusPollScheduler::jobAirtimeMs(const ModbusPollJob &job, const ModbusPollJob *candidate) const
+{
+    double airtime = m_master->airtimeMs(job.toRequest());
+    if (job.selectionCode < 0) return airtime;
+    // 同一从站上还有选择别的设备的任务(包括待加入的 candidate)时，每次读取前都要再写一次选择寄存器
+    bool conflict = candidate && selectsOther(*candidate, job);
+    for (int i = 0; !conflict && i < m_entries.size(); ++i) {
+        conflict = selectsOther(m_entries.at(i).job, job);
+    }
+    if (!conflict) return airtime;
+    ModbusRequest selection = ModbusRequest::writeSingleRegister(job.slaveId, m_selectionRegister,
+                                                                 static_cast<quint16>(job.selectionCode));
+    return airtime + m_master->airtimeMs(selection);
+}
+
+bool ModbusPollScheduler::selectsOther(const ModbusPollJob &other, const ModbusPollJob &job)
+{
+    return other.id != job.id && other.slaveId == job.slaveId
+            && other.selectionCode >= 0 && other.selectionCode != job.selectionCode;
+}
+
+double ModbusPollScheduler::utilization() const
+{
+    return loadExcluding(QList<int>());
+}
+
+double ModbusPollScheduler::loadExcluding(const QList<int> &excludedJobIds, const ModbusPollJob *candidate) const
+{
+    double load = 0;
+    for (const JobEntry &entry : m_entries) {
+        if (excludedJobIds.contains(entry.job.id)) continue;
+        load += jobAirtimeMs(entry.job, candidate) / entry.job.periodMs;
+    }
+    return load;
+}
+
+int ModbusPollScheduler::densestPeriodMs(const QList<int> &jobIds) const
+{
+    double airtime = 0;
+    for (const JobEntry &entry : m_entries) {
+        if (jobIds.contains(entry.job.id)) airtime += jobAirtimeMs(entry.job);
+    }
+    double spare = m_maxUtilization - loadExcluding(jobIds);
+    if (spare <= 0) return -1;
+    return qMax(1, static_cast<int>(std::ceil(airtime / spare)));
+}
+
+int ModbusPollScheduler::feasiblePeriod(const ModbusPollJob &job, int requestedMs) const
+{
+    // job 可能尚未加入任务表: 它与同一从站其他任务的选择冲突会使那些任务也要每次写选择寄存器
+    double spare = m_maxUtilization - loadExcluding(QList<int>() << job.id, &job);
+    double airtime = jobAirtimeMs(job);
+    if (spare > 0 && airtime / requestedMs <= spare) return requestedMs;
+    if (m_overloadPolicy == RejectOverload || spare <= 0) return -1;
+    return static_cast<int>(std::ceil(airtime / spare));
+}
+
+QList<ModbusPollJob> ModbusPollScheduler::jobs() const
+{
+    QList<ModbusPollJob> result;
+    for (const JobEntry &entry : m_entries) {
+        result.append(entry.job);
+    }
+    return result;
+}
+
+ModbusPollJobStatistics ModbusPollScheduler::statistics(int jobId) const
+{
+    int index = indexOfJob(jobId);
+    return index < 0 ? ModbusPollJobStatistics() : m_entries.at(index).stats;
+}
+
+QJsonArray ModbusPollScheduler::statisticsToJson(const QList<int> &jobIds) const
+{
+    QJsonArray array;
+    for (const JobEntry &entry : m_entries) {
+        if (!jobIds.isEmpty() && !jobIds.contains(entry.job.id)) continue;
+        QJsonObject object = entry.job.toJson();
+        object["requestedHz"] = 1000.0 / entry.job.periodMs;
+        object["achievedHz"] = entry.stats.achievedHz();
+        object["polls"] = static_cast<double>(entry.stats.polls);
+        object["failures"] = static_cast<double>(entry.stats.failures);
+        object["jitterMs"] = entry.stats.jitterMs;
+        object["maxJitterMs"] = static_cast<double>(entry.stats.maxJitterMs);
+        object["jitterP50Ms"] = static_cast<double>(entry.stats.jitterPercentile(0.50));
+        object["jitterP99Ms"] = static_cast<double>(entry.stats.jitterPercentile(0.99));
+        object["overruns"] = static_cast<double>(entry.stats.overruns);
+        object["coalescedPolls"] = static_cast<double>(entry.stats.coalesced);
+        double airtime = jobAirtimeMs(entry.job);
+        object["airtimeMs"] = airtime;
+        object["load"] = airtime / entry.job.periodMs;
+        array.append(object);
+    }
+    return array;
+}
+
+void ModbusPollScheduler::setSelectionRegister(quint16 address)
+{
+    m_selectionRegister = address;
+    invalidateSelections();
+}
+
+int ModbusPollScheduler::selectedDevice(quint8 slaveId) const
+{
+    return m_selectedDevice.value(slaveId, -1);
+}
+
+void ModbusPollScheduler::invalidateSelections()
+{
+    m_selectedDevice.clear();
+}
+
+quint64 ModbusPollScheduler::selectionWrites() const
+{
+    return m_selectionWrites;
+}
+
+quint64 ModbusPollScheduler::selectionsSkipped() const
+{
+    return m_selectionsSkipped;
+}
+
+void ModbusPollScheduler::start()
+{
+    // 启动时先各读一次，之后对齐到墙钟相位
+    m_wallOffsetMs = QDateTime::currentMSecsSinceEpoch() - m_clock.elapsed();
+    qint64 now = m_clock.elapsed();
+    for (JobEntry &entry : m_entries) {
+        entry.nextDueMs = now;
+        entry.aligned = false;
+    }
+    m_running = true;
+    dispatch();
+}
+
+void ModbusPollScheduler::stop()
+{
+    m_running = false;
+    m_timer->stop();
+}
+
+bool ModbusPollScheduler::isRunning() const
+{
+    return m_running;
+}
+
+void ModbusPollScheduler::onReplyReceived(const ModbusReply &reply)
+{
+    observeReply(reply);
+
+    if (m_outstandingJobId != 0 && reply.id == m_outstandingSelectionId) {
+        // 选择写与读取由主站连续发送，读取的应答随后到达；选择写失败时读取以同样的错误结束
+        m_outstandingSelectionId = 0;
+        emit jobReplied(m_outstandingJobId, reply);
+        return;
+    }
+    if (m_outstandingJobId != 0 && reply.id == m_outstandingId) {
+        QList<int> group = m_outstandingGroup;
+        m_outstandingJobId = 0;
+        m_outstandingSelectionId = 0;
+        m_outstandingGroup.clear();
+        finishGroup(group, reply);
+    }
+    dispatch();
+}
+
+void ModbusPollScheduler::observeReply(const ModbusReply &reply)
+{
+    const ModbusRequest &request = reply.request;
+    if (reply.error == ModbusReply::PortError) {
+        invalidateSelections();
+        return;
+    }
+    if (request.functionCode != 0x06 || request.data.size() < 4) {
+        // 从站无应答时可能已复位，选择状态不再可信
+        if (reply.error == ModbusReply::TimeoutError) m_selectedDevice.remove(request.slaveId);
+        return;
+    }
+
+    quint16 address = (static_cast<quint8>(request.data[0]) << 8) | static_cast<quint8>(request.data[1]);
+    if (address != m_selectionRegister) return;
+    if (reply.isValid()) {
+        quint16 value = (static_cast<quint8>(request.data[2]) << 8) | static_cast<quint8>(request.data[3]);
+        m_selectedDevice.insert(request.slaveId, value);
+    } else {
+        m_selectedDevice.remove(request.slaveId);
+    }
+}
+
+bool ModbusPollScheduler::needsSelection(const ModbusPollJob &job) const
+{
+    return job.selectionCode >= 0 && m_selectedDevice.value(job.slaveId, -1) != job.selectionCode;
+}
+
+void ModbusPollScheduler::dispatch()
+{
+    // 调度器自己的事务未完成，或主站还有别的请求排队时不发，等 replyReceived 再来
+    if (!m_running || m_outstandingJobId != 0 || m_entries.isEmpty()) return;
+    if (m_master->pendingCount() > 0) return;
+    if (!m_master->isOpen()) {
+        // 串口关闭时不发送，避免主站同步返回串口错误后立即重入调度
+        m_timer->start(kPortClosedRetryMs);
+        return;
+    }
+
+    // 到期任务中: 优先级高者先；同优先级无需切换设备选择者先；再按到期先后
+    qint64 now = m_clock.elapsed();
+    int selected = -1;
+    bool selectedSwitches = false;
+    qint64 earliestDue = m_entries.first().nextDueMs;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const JobEntry &entry = m_entries.at(i);
+        earliestDue = qMin(earliestDue, entry.nextDueMs);
+        if (entry.nextDueMs > now) continue;
+        bool switches = needsSelection(entry.job);
+        if (selected >= 0) {
+            const JobEntry &best = m_entries.at(selected);
+            if (entry.job.priority != best.job.priority) {
+                if (entry.job.priority < best.job.priority) continue;
+            } else if (switches != selectedSwitches) {
+                if (switches) continue;
+            } else if (entry.nextDueMs >= best.nextDueMs) {
+                continue;
+            }
+        }
+        selected = i;
+        selectedSwitches = switches;
+    }
+
+    if (selected < 0) {
+        m_timer->start(static_cast<int>(earliestDue - now));
+        return;
+    }
+
+    JobEntry &entry = m_entries[selected];
+    QList<Overrun> overruns;
+    advance(entry, now, &overruns);
+    if (entry.job.selectionCode >= 0 && !selectedSwitches) ++m_selectionsSkipped;
+
+    // 同一从站、同一功能码和设备选择的其他到期任务，地址相邻(间隔不超过 m_maxCoalesceGap)时
+    // 并入同一次块读取，总长度不超过 kMaxReadRegisters
+    QList<int> group;
+    group.append(entry.job.id);
+    int low = entry.job.address;
+    int high = entry.job.address + entry.job.count;
+    bool grown = m_maxCoalesceGap >= 0 && entry.coalesce;
+    while (grown) {
+        grown = false;
+        for (JobEntry &other : m_entries) {
+            const ModbusPollJob &job = other.job;
+            if (group.contains(job.id) || !other.coalesce || other.nextDueMs > now) continue;
+            if (job.slaveId != entry.job.slaveId || job.functionCode != entry.job.functionCode
+                    || job.selectionCode != entry.job.selectionCode) {
+                continue;
+            }
+            int gap = qMax(job.address - high, low - (job.address + job.count));
+            int newLow = qMin(low, int(job.address));
+            int newHigh = qMax(high, job.address + job.count);
+            if (gap > m_maxCoalesceGap || newHigh - newLow > kMaxReadRegisters) continue;
+            low = newLow;
+            high = newHigh;
+            group.append(job.id);
+            advance(other, now, &overruns);
+            grown = true;
+        }
+    }
+
+    m_outstandingGroup = group;
+    m_blockAddress = static_cast<quint16>(low);
+    m_blockCount = static_cast<quint16>(high - low);
+    send(entry.job, selectedSwitches);
+    for (const Overrun &item : qAsConst(overruns)) {
+        emit overrun(item.jobId, item.missedCycles, item.latenessMs);
+    }
+}
+
+void ModbusPollScheduler::advance(JobEntry &entry, qint64 now, QList<Overrun> *overruns)
+{
+    qint64 lateness = now - entry.nextDueMs;
+    int missed = static_cast<int>(lateness / entry.job.periodMs);
+    if (entry.aligned) {
+        // 抖动只统计对齐后的轮次，启动时的首次读取不计
+        entry.stats.jitterMs += kIntervalSmoothing * (lateness - entry.stats.jitterMs);
+        entry.stats.maxJitterMs = qMax(entry.stats.maxJitterMs, lateness);
+        entry.stats.addJitter(lateness);
+
+        // 到期时刻按周期累加；错过的轮次跳过但保持相位，不补发
+        entry.nextDueMs += static_cast<qint64>(missed + 1) * entry.job.periodMs;
+        if (missed > 0) {
+            entry.stats.overruns += missed;
+            overruns->append(Overrun{ entry.job.id, missed, lateness });
+        }
+    } else {
+        entry.nextDueMs = alignedDeadline(entry.job, now);
+        entry.aligned = true;
+    }
+
+    if (entry.stats.lastSentMs >= 0) {
+        double interval = now - entry.stats.lastSentMs;
+        entry.stats.intervalMs = entry.stats.intervalMs > 0
+                ? entry.stats.intervalMs + kIntervalSmoothing * (interval - entry.stats.intervalMs)
+                : interval;
+    }
+    entry.stats.lastSentMs = now;
+}
+
+void ModbusPollScheduler::send(const ModbusPollJob &job, bool selection)
+{
+    ModbusRequest request;
+    if (m_outstandingGroup.size() > 1) {
+        ModbusPollJob block = job;
+        block.address = m_blockAddress;
+        block.count = m_blockCount;
+        request = block.toRequest();
+        ++m_coalescedReads;
+    } else {
+        request = job.toRequest();
+    }
+
+    m_outstandingJobId = job.id;
+    m_outstandingSelectionId = 0;
+    if (selection) {
+        // 选择写和读取作为一组交给主站，中间不会插入其他请求(包括按需通道)改变选择
+        ModbusRequest select = ModbusRequest::writeSingleRegister(job.slaveId, m_selectionRegister,
+                                                                  static_cast<quint16>(job.selectionCode));
+        select.tag = job.selectionTag;
+        select.lane = ModbusRequest::PeriodicLane;
+        QList<quint32> ids = m_master->sendChain(QList<ModbusRequest>() << select << request);
+        if (ids.size() == 2) {
+            ++m_selectionWrites;
+            m_outstandingSelectionId = ids.at(0);
+            m_outstandingId = ids.at(1);
+        } else {
+            m_outstandingId = 0;
+        }
+    } else {
+        m_outstandingId = m_master->sendRequest(request);
+    }
+
+    if (m_outstandingId == 0) {
+        // 通道已满: 本轮计为失败，到期时刻已顺延，稍后再调度
+        QList<int> group = m_outstandingGroup;
+        m_outstandingJobId = 0;
+        m_outstandingGroup.clear();
+        for (int jobId : group) {
+            int index = indexOfJob(jobId);
+            if (index < 0) continue;
+            ++m_entries[index].stats.polls;
+            ++m_entries[index].stats.failures;
+        }
+        m_timer->start(kLaneFullRetryMs);
+    }
+}
+
+void ModbusPollScheduler::finishGroup(const QList<int> &group, const ModbusReply &reply)
+{
+    // 块读取失败且从站返回异常(多为地址间隙中有不存在的寄存器)时，这些任务以后不再合并
+    if (group.size() > 1 && reply.error == ModbusReply::ExceptionError) {
+        for (int jobId : group) {
+            int index = indexOfJob(jobId);
+            if (index >= 0) m_entries[index].coalesce = false;
+        }
+    }
+
+    for (int jobId : group) {
+        int index = indexOfJob(jobId);
+        if (index < 0) continue;
+        JobEntry &entry = m_entries[index];
+        ++entry.stats.polls;
+        if (!reply.isValid()) ++entry.stats.failures;
+        if (group.size() == 1 || reply.request.functionCode == 0x06) {
+            emit jobReplied(jobId, reply);
+            continue;
+        }
+        // 从块读取的数据区中切出本任务的寄存器，仍是视图不复制
+        ModbusReply part = reply;
+        part.request = entry.job.toRequest();
+        part.payloadOffset = (entry.job.address - m_blockAddress) * 2;
+        part.payloadLength = entry.job.count * 2;
+        ++entry.stats.coalesced;
+        emit jobReplied(jobId, part);
+    }
+}
+
+qint64 ModbusPollScheduler::alignedDeadline(const ModbusPollJob &job, qint64 now) const
+{
+    qint64 period = job.periodMs;
+    qint64 wall = now + m_wallOffsetMs - job.phaseMs;
+    qint64 slot = (wall / period + 1) * period;
+    return slot + job.phaseMs - m_wallOffsetMs;
+}
+
+int ModbusPollScheduler::indexOfJob(int jobId) const
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).job.id == jobId) return i;
+    }
+    return -1;
+}
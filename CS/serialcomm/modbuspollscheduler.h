@@ -0,0 +1,202 @@
+#ifndef MODBUSPOLLSCHEDULER_H
+#define MODBUSPOLLSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "modbusrtumaster.h"
+
+class QTimer;
+
+// 一条轮询任务: 按周期读取某个从站的一段寄存器
+struct ModbusPollJob
+{
+    int id = 0;              // 由调度器分配
+    quint8 slaveId = 1;
+    quint8 functionCode = 0x03;
+    quint16 address = 0;
+    quint16 count = 1;
+    int periodMs = 5000;
+    int phaseMs = 0;         // 在周期内的相位: 发送时刻对齐到 墙钟 ≡ phaseMs (mod periodMs)
+    int priority = 0;        // 同时到期时数值大的先发
+    int tag = 0;             // 随应答带回(ModbusReply::request.tag)
+    // 读取前需在从站上选中的设备码(0x06写入选择寄存器)，-1 表示无需选择
+    int selectionCode = -1;
+    int selectionTag = 0;    // 选择写请求的标记
+
+    ModbusRequest toRequest() const;
+    // 缺省字段取 defaults 中的值。interval 为周期(毫秒)，与页面原有协议一致
+    static ModbusPollJob fromJson(const QJsonObject &object, const ModbusPollJob &defaults);
+    QJsonObject toJson() const;
+};
+
+// 单条任务的运行统计
+struct ModbusPollJobStatistics
+{
+    quint64 polls = 0;      // 已完成事务数
+    quint64 failures = 0;   // 其中失败(超时/CRC/异常等)次数
+    double intervalMs = 0;  // 相邻两次发送间隔的滑动平均
+    qint64 lastSentMs = -1; // 最近一次发送时刻(调度器时钟)
+    // 实际发送时刻晚于到期时刻的量(调度抖动): 滑动平均和最大值
+    double jitterMs = 0;
+    qint64 maxJitterMs = 0;
+    // 最近 JitterWindow 次的抖动，用于分位数
+    enum { JitterWindow = 256 };
+    QVector<qint32> recentJitterMs;
+    int jitterCursor = 0;
+    quint64 overruns = 0;   // 总线跟不上而跳过的轮次
+    quint64 coalesced = 0;  // 由合并的块读取完成的轮询数
+
+    double achievedHz() const { return intervalMs > 0 ? 1000.0 / intervalMs : 0.0; }
+    void addJitter(qint64 latenessMs);
+    // 最近抖动的分位数(0~1)，无样本时为 0
+    qint64 jitterPercentile(double fraction) const;
+};
+
+// 单总线多从站轮询调度器。
+// 持有一张任务表，按到期时间和优先级依次把请求交给主站，调度器自身始终最多只有一个
+// 未完成事务；主站被其他请求占用时等其空闲后再发。
+// 到期时刻是单调时钟上的绝对时刻，按周期累加而不是从实际发送时刻重新计时，不会漂移；
+// 首次发送之后对齐到墙钟上周期的整数倍(加 phaseMs)，如 5 秒周期落在 :00、:05、:10…。
+// 总线跟不上时跳过错过的轮次、保持相位，不补发，跳过的轮次计入统计并发出 overrun()。
+//
+// 每条任务按波特率、帧长和从站处理时间估算单次事务的总线占用(airtime)，
+// 总线利用率 = Σ airtime / 周期。新增任务或改周期使利用率超过上限(默认 0.8，留出按需读取的余量)时，
+// 按 OverloadPolicy 拒绝，或把该任务的周期拉长到刚好可行的值并发出 periodAdjusted()。
+//
+// 同时到期、同一从站/功能码/设备选择、地址重叠或相邻的任务合并为一次块读取(不超过125个寄存器)，
+// 应答按各任务的地址切分后分别从 jobReplied() 发出。允许的地址间隙由 setMaxCoalesceGap() 设置，
+// 默认 0 只合并重叠和紧邻的区间；块读取返回异常码时，这些任务以后不再合并。
+//
+// 局放、微水等设备共用从站地址，读数据前须先把设备码写入从站的选择寄存器。
+// 调度器记录每个从站当前选中的设备(也观察页面自己发出的选择写)，已选中时跳过选择写；
+// 同优先级的到期任务中优先执行无需切换选择的，使依赖同一设备的读请求连续执行。
+class ModbusPollScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum OverloadPolicy {
+        RejectOverload,  // 拒绝超出容量的任务或周期
+        StretchOverload  // 拉长周期直到可行
+    };
+
+    explicit ModbusPollScheduler(ModbusRtuMaster *master, QObject *parent = nullptr);
+
+    // 返回任务编号，超出总线容量被拒绝时返回 0
+    int addJob(const ModbusPollJob &job);
+    bool removeJob(int jobId);
+    void clearJobs();
+    // 超出总线容量被拒绝时返回 false
+    bool setJobPeriod(int jobId, int periodMs);
+    void setAllPeriods(int periodMs);
+
+    // 合并读取允许的最大间隙(寄存器数)，-1 表示不合并
+    void setMaxCoalesceGap(int registers);
+    int maxCoalesceGap() const;
+    quint64 coalescedReads() const;
+
+    // 总线容量
+    void setMaxUtilization(double fraction);
+    double maxUtilization() const;
+    void setOverloadPolicy(OverloadPolicy policy);
+    OverloadPolicy overloadPolicy() const;
+    double jobAirtimeMs(const ModbusPollJob &job) const;
+    // 当前任务表的总线利用率(0~1，可能因波特率改变而超过上限)
+    double utilization() const;
+    // jobIds 这组任务共用一个周期时，在其余任务负载不变的前提下可行的最短周期；不可行时返回 -1
+    int densestPeriodMs(const QList<int> &jobIds) const;
+    QList<ModbusPollJob> jobs() const;
+    ModbusPollJobStatistics statistics(int jobId) const;
+    // 各任务的设定速率、实际速率和失败次数；jobIds 为空时输出全部任务
+    QJsonArray statisticsToJson(const QList<int> &jobIds = QList<int>()) const;
+
+    // 设备选择寄存器，默认 0x0001
+    void setSelectionRegister(quint16 address);
+    // 从站当前选中的设备码，未知时返回 -1
+    int selectedDevice(quint8 slaveId) const;
+    void invalidateSelections();
+    quint64 selectionWrites() const;
+    quint64 selectionsSkipped() const;
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+signals:
+    // 轮询任务的应答(包括调度器代发的设备选择写)。帧视图只在本信号分发期间有效，只能直接连接
+    void jobReplied(int jobId, const ModbusReply &reply);
+    // 任务发送时已错过 missedCycles 个周期
+    void overrun(int jobId, int missedCycles, qint64 latenessMs);
+    // 总线容量不足，任务周期由 requestedMs 拉长到 periodMs
+    void periodAdjusted(int jobId, int requestedMs, int periodMs);
+
+private slots:
+    void onReplyReceived(const ModbusReply &reply);
+    void dispatch();
+
+private:
+    struct JobEntry {
+        ModbusPollJob job;
+        ModbusPollJobStatistics stats;
+        qint64 nextDueMs;
+        bool aligned;    // nextDueMs 已对齐到墙钟相位
+        bool coalesce;   // 允许与其他任务合并读取
+    };
+
+    struct Overrun {
+        int jobId;
+        int missedCycles;
+        qint64 latenessMs;
+    };
+
+    int indexOfJob(int jobId) const;
+    bool needsSelection(const ModbusPollJob &job) const;
+    // 任务表中的任务再加上 candidate(可为空)时 job 的单次占用时间
+    double jobAirtimeMs(const ModbusPollJob &job, const ModbusPollJob *candidate) const;
+    // job 与 other 在同一从站上选择不同的设备
+    static bool selectsOther(const ModbusPollJob &other, const ModbusPollJob &job);
+    // 除 excludedJobIds 外各任务的利用率之和，candidate 为待加入(或修改周期)的任务
+    double loadExcluding(const QList<int> &excludedJobIds, const ModbusPollJob *candidate = nullptr) const;
+    // 按容量策略确定任务的周期: 可行时原样返回，拉长时返回新周期，拒绝时返回 -1
+    int feasiblePeriod(const ModbusPollJob &job, int requestedMs) const;
+    // now 之后第一个与墙钟相位对齐的到期时刻
+    qint64 alignedDeadline(const ModbusPollJob &job, qint64 now) const;
+    void observeReply(const ModbusReply &reply);
+    // 记录一次发送: 抖动、顺延到期时刻、间隔统计
+    void advance(JobEntry &entry, qint64 now, QList<Overrun> *overruns);
+    // 发送 m_outstandingGroup 的(块)读取；selection 时先写选择寄存器，两者作为一组连续发送
+    void send(const ModbusPollJob &job, bool selection);
+    // 统计并分发一组任务的应答，块读取按地址切分
+    void finishGroup(const QList<int> &group, const ModbusReply &reply);
+
+    ModbusRtuMaster *m_master;
+    QTimer *m_timer; // 等待下一条任务到期
+    QElapsedTimer m_clock;
+    qint64 m_wallOffsetMs;  // 墙钟毫秒 - m_clock，启动时取一次，之后只用单调时钟
+    QList<JobEntry> m_entries;
+    bool m_running;
+    int m_nextJobId;
+    int m_outstandingJobId;    // 未完成事务所属任务，无则为0
+    quint32 m_outstandingId;   // 对应的主站事务编号(读取)
+    quint32 m_outstandingSelectionId; // 同组中先发的选择写，无则为0
+    QList<int> m_outstandingGroup; // 本次(块)读取包含的任务，首项为 m_outstandingJobId
+    quint16 m_blockAddress;
+    quint16 m_blockCount;
+
+    double m_maxUtilization;
+    OverloadPolicy m_overloadPolicy;
+    int m_maxCoalesceGap;
+    quint64 m_coalescedReads;
+
+    quint16 m_selectionRegister;
+    QHash<quint8, int> m_selectedDevice; // 从站地址 -> 当前选中的设备码
+    quint64 m_selectionWrites;
+    quint64 m_selectionsSkipped;
+};
+
+#endif // MODBUSPOLLSCHEDULER_H
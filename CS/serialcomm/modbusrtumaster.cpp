@@ -0,0 +1,754 @@
+#include "modbusrtumaster.h"
+#include <QTimer>
+
+namespace {
+const int kMinSilenceMs = 2; // 定时器精度下限
+const int kDefaultTurnaroundMs = 100; // 从站处理时间 + USB转串口延迟
+const int kDefaultMaxRetries = 2;
+const int kDefaultBackoffMs = 50;
+const int kDefaultMaxBackoffMs = 800;
+const int kMaxAduLength = 256; // Modbus RTU 帧最大长度
+// 各优先通道的默认最大排队数: 按需 / 报警 / 周期 / 探测
+const int kDefaultLaneDepths[ModbusRequest::LaneCount] = { 16, 16, 64, 8 };
+const double kLatencySmoothing = 0.2;
+
+ModbusRequest makeRequest(quint8 slaveId, quint8 functionCode, quint16 first, quint16 second)
+{
+    ModbusRequest request;
+    request.slaveId = slaveId;
+    request.functionCode = functionCode;
+    request.data.append(static_cast<char>((first >> 8) & 0xFF));
+    request.data.append(static_cast<char>(first & 0xFF));
+    request.data.append(static_cast<char>((second >> 8) & 0xFF));
+    request.data.append(static_cast<char>(second & 0xFF));
+    return request;
+}
+}
+
+ModbusRequest ModbusRequest::readHoldingRegisters(quint8 slaveId, quint16 address, quint16 count)
+{
+    return makeRequest(slaveId, 0x03, address, count);
+}
+
+ModbusRequest ModbusRequest::readInputRegisters(quint8 slaveId, quint16 address, quint16 count)
+{
+    return makeRequest(slaveId, 0x04, address, count);
+}
+
+ModbusRequest ModbusRequest::writeSingleRegister(quint8 slaveId, quint16 address, quint16 value)
+{
+    return makeRequest(slaveId, 0x06, address, value);
+}
+
+QByteArray ModbusRequest::toAdu() const
+{
+    QByteArray adu;
+    adu.reserve(2 + data.size() + 2);
+    adu.append(static_cast<char>(slaveId));
+    adu.append(static_cast<char>(functionCode));
+    adu.append(data);
+
+    quint16 crc = ModbusCrc::calculate(adu.constData(), adu.size());
+    adu.append(static_cast<char>(crc & 0xFF));        // CRC低字节
+    adu.append(static_cast<char>((crc >> 8) & 0xFF)); // CRC高字节
+    return adu;
+}
+
+int ModbusRequest::expectedResponseLength() const
+{
+    switch (functionCode) {
+    case 0x03:
+    case 0x04: {
+        if (data.size() < 4) return -1;
+        quint16 count = (static_cast<quint8>(data[2]) << 8) | static_cast<quint8>(data[3]);
+        return 3 + count * 2 + 2;
+    }
+    case 0x05:
+    case 0x06:
+    case 0x0F:
+    case 0x10:
+        return 8;
+    default:
+        return -1;
+    }
+}
+
+ModbusFrameView ModbusReply::payload() const
+{
+    if (frame.size() < 5) return ModbusFrameView();
+    ModbusFrameView data = frame.mid(3, frame.at(2));
+    return payloadLength < 0 ? data : data.mid(payloadOffset, payloadLength);
+}
+
+QString ModbusReply::errorString() const
+{
+    switch (error) {
+    case NoError: return QString();
+    case ExceptionError: return "Modbus异常响应: " + ModbusRtuMaster::exceptionText(exceptionCode);
+    case CrcError: return "CRC校验失败";
+    case FrameError: return "应答帧格式错误";
+    case TimeoutError: return "应答超时";
+    case PortError: return "串口错误";
+    }
+    return QString();
+}
+
+QString ModbusReply::outcomeName() const
+{
+    switch (error) {
+    case NoError: return "ok";
+    case ExceptionError: return "exception";
+    case CrcError: return "crc";
+    case FrameError: return "frame";
+    case TimeoutError: return "timeout";
+    case PortError: return "port";
+    }
+    return QString();
+}
+
+ModbusRtuMaster::ModbusRtuMaster(QObject *parent) :
+    QObject(parent),
+    m_serialPort(new QSerialPort(this)),
+    m_frameTimer(new QTimer(this)),
+    m_responseTimer(new QTimer(this)),
+    m_retryTimer(new QTimer(this)),
+    m_framingMode(LengthFraming),
+    m_frameTimeoutMs(0),
+    m_responseTimeoutMs(0),
+    m_turnaroundMs(kDefaultTurnaroundMs),
+    m_maxRetries(kDefaultMaxRetries),
+    m_backoffMs(kDefaultBackoffMs),
+    m_maxBackoffMs(kDefaultMaxBackoffMs),
+    m_crcLength(0),
+    m_busy(false),
+    m_dispatching(false),
+    m_chainLane(-1),
+    m_nextId(1),
+    m_discardedBytes(0)
+{
+    qRegisterMetaType<ModbusReply>("ModbusReply");
+    m_clock.start();
+    for (int lane = 0; lane < ModbusRequest::LaneCount; ++lane) {
+        m_laneStatistics[lane].maxDepth = kDefaultLaneDepths[lane];
+    }
+
+    m_frameTimer->setSingleShot(true);
+    m_frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_frameTimer, &QTimer::timeout, this, &ModbusRtuMaster::onFrameTimeout);
+
+    m_responseTimer->setSingleShot(true);
+    connect(m_responseTimer, &QTimer::timeout, this, &ModbusRtuMaster::onResponseTimeout);
+
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &ModbusRtuMaster::onRetryTimeout);
+
+    connect(m_serialPort, &QSerialPort::readyRead, this, &ModbusRtuMaster::onReadyRead);
+    connect(m_serialPort, static_cast<void (QSerialPort::*)(QSerialPort::SerialPortError)>(&QSerialPort::error),
+            this, &ModbusRtuMaster::onSerialError);
+}
+
+ModbusRtuMaster::~ModbusRtuMaster()
+{
+    if (m_serialPort->isOpen()) m_serialPort->close();
+}
+
+bool ModbusRtuMaster::open(const QString &portName, qint32 baudRate)
+{
+    if (m_serialPort->isOpen()) close();
+
+    m_serialPort->setPortName(portName);
+    m_serialPort->setBaudRate(baudRate);
+    m_serialPort->setDataBits(QSerialPort::Data8);
+    m_serialPort->setParity(QSerialPort::NoParity);
+    m_serialPort->setStopBits(QSerialPort::OneStop);
+    m_serialPort->setFlowControl(QSerialPort::NoFlowControl);
+
+    if (!m_serialPort->open(QIODevice::ReadWrite)) return false;
+    m_serialPort->setReadBufferSize(4096);
+    m_frameTimer->setInterval(silenceIntervalMs());
+    clearReceivedBuffer();
+    return true;
+}
+
+void ModbusRtuMaster::close()
+{
+    if (m_serialPort->isOpen()) m_serialPort->close();
+    m_frameTimer->stop();
+    m_retryTimer->stop();
+    clearReceivedBuffer();
+
+    // 关闭串口时，未完成的事务全部以串口错误结束
+    clearQueue();
+    if (m_busy) finishCurrent(ModbusReply::PortError);
+}
+
+bool ModbusRtuMaster::isOpen() const
+{
+    return m_serialPort->isOpen();
+}
+
+QString ModbusRtuMaster::portName() const
+{
+    return m_serialPort->portName();
+}
+
+qint32 ModbusRtuMaster::baudRate() const
+{
+    return m_serialPort->baudRate();
+}
+
+QString ModbusRtuMaster::errorString() const
+{
+    return m_serialPort->errorString();
+}
+
+bool ModbusRtuMaster::isBusy() const
+{
+    return m_busy;
+}
+
+int ModbusRtuMaster::pendingCount() const
+{
+    int count = m_busy ? 1 : 0;
+    for (const QQueue<PendingRequest> &queue : m_queues) count += queue.size();
+    return count;
+}
+
+quint64 ModbusRtuMaster::discardedBytes() const
+{
+    return m_discardedBytes;
+}
+
+void ModbusRtuMaster::setFramingMode(FramingMode mode)
+{
+    m_framingMode = mode;
+}
+
+ModbusRtuMaster::FramingMode ModbusRtuMaster::framingMode() const
+{
+    return m_framingMode;
+}
+
+void ModbusRtuMaster::setFrameTimeout(int ms)
+{
+    m_frameTimeoutMs = qMax(0, ms);
+    m_frameTimer->setInterval(silenceIntervalMs());
+}
+
+void ModbusRtuMaster::setResponseTimeout(int ms)
+{
+    m_responseTimeoutMs = qMax(0, ms);
+}
+
+void ModbusRtuMaster::setTurnaroundTime(int ms)
+{
+    m_turnaroundMs = qMax(0, ms);
+}
+
+void ModbusRtuMaster::setRetryPolicy(int maxRetries, int backoffMs, int maxBackoffMs)
+{
+    m_maxRetries = qMax(0, maxRetries);
+    m_backoffMs = qMax(0, backoffMs);
+    m_maxBackoffMs = qMax(m_backoffMs, maxBackoffMs);
+}
+
+int ModbusRtuMaster::responseTimeoutFor(const ModbusRequest &request) const
+{
+    if (request.timeoutMs > 0) return request.timeoutMs;
+    if (m_responseTimeoutMs > 0) return m_responseTimeoutMs;
+
+    // 定时器在写入时启动，期限需覆盖请求发出、应答传回(每字节11位)和帧结束静默
+    int responseLength = request.expectedResponseLength();
+    if (responseLength < 0) responseLength = kMaxAduLength;
+    int bytes = 2 + request.data.size() + 2 + responseLength;
+    qint32 baud = qMax(1, m_serialPort->baudRate());
+    int transferMs = static_cast<int>(bytes * 11 * 1000.0 / baud + 0.999);
+    return transferMs + silenceIntervalMs() + m_turnaroundMs;
+}
+
+double ModbusRtuMaster::airtimeMs(const ModbusRequest &request) const
+{
+    int responseLength = request.expectedResponseLength();
+    if (responseLength < 0) responseLength = kMaxAduLength;
+    int bytes = 2 + request.data.size() + 2 + responseLength;
+    qint32 baud = qMax(1, m_serialPort->baudRate());
+    return bytes * 11 * 1000.0 / baud + 2 * silenceIntervalMs() + m_turnaroundMs;
+}
+
+ModbusRtuMaster::Statistics ModbusRtuMaster::statistics() const
+{
+    return m_statistics;
+}
+
+ModbusRtuMaster::LaneStatistics ModbusRtuMaster::laneStatistics(ModbusRequest::Lane lane) const
+{
+    LaneStatistics stats = m_laneStatistics[lane];
+    stats.queued = m_queues[lane].size();
+    return stats;
+}
+
+void ModbusRtuMaster::setLaneDepth(ModbusRequest::Lane lane, int maxDepth)
+{
+    m_laneStatistics[lane].maxDepth = qMax(1, maxDepth);
+}
+
+QString ModbusRtuMaster::laneName(ModbusRequest::Lane lane)
+{
+    switch (lane) {
+    case ModbusRequest::InteractiveLane: return "interactive";
+    case ModbusRequest::AlarmLane: return "alarm";
+    case ModbusRequest::PeriodicLane: return "periodic";
+    case ModbusRequest::DiscoveryLane: return "discovery";
+    case ModbusRequest::LaneCount: break;
+    }
+    return QString();
+}
+
+quint32 ModbusRtuMaster::sendRequest(const ModbusRequest &request)
+{
+    QQueue<PendingRequest> &queue = m_queues[request.lane];
+    LaneStatistics &stats = m_laneStatistics[request.lane];
+    if (queue.size() >= stats.maxDepth) {
+        ++stats.rejected;
+        emit errorOccurred(QString("%1 通道已有 %2 条请求排队，本次请求被丢弃。")
+                           .arg(laneName(request.lane)).arg(queue.size()));
+        return 0;
+    }
+
+    quint32 id = enqueue(request, request.lane, false);
+    // 分发应答期间提交的请求，待分发结束(接收视图失效)后再发送
+    if (!m_busy && !m_dispatching) startNext();
+    return id;
+}
+
+QList<quint32> ModbusRtuMaster::sendChain(const QList<ModbusRequest> &requests)
+{
+    QList<quint32> ids;
+    if (requests.isEmpty()) return ids;
+    ModbusRequest::Lane lane = requests.first().lane;
+    QQueue<PendingRequest> &queue = m_queues[lane];
+    LaneStatistics &stats = m_laneStatistics[lane];
+    if (queue.size() + requests.size() > stats.maxDepth) {
+        stats.rejected += requests.size();
+        emit errorOccurred(QString("%1 通道已有 %2 条请求排队，本组 %3 条请求被丢弃。")
+                           .arg(laneName(lane)).arg(queue.size()).arg(requests.size()));
+        return ids;
+    }
+
+    for (int i = 0; i < requests.size(); ++i) {
+        ids.append(enqueue(requests.at(i), lane, i + 1 < requests.size()));
+    }
+    if (!m_busy && !m_dispatching) startNext();
+    return ids;
+}
+
+quint32 ModbusRtuMaster::enqueue(const ModbusRequest &request, ModbusRequest::Lane lane, bool chained)
+{
+    PendingRequest pending;
+    pending.id = m_nextId++;
+    if (m_nextId == 0) m_nextId = 1; // 0 表示请求被拒绝
+    pending.request = request;
+    pending.request.lane = lane;
+    pending.attempts = 0;
+    pending.queuedAtMs = m_clock.elapsed();
+    pending.chained = chained;
+    m_queues[lane].enqueue(pending);
+    return pending.id;
+}
+
+void ModbusRtuMaster::clearQueue()
+{
+    m_chainLane = -1;
+    for (QQueue<PendingRequest> &queue : m_queues) {
+        while (!queue.isEmpty()) {
+            PendingRequest pending = queue.dequeue();
+            countFinished(pending, ModbusReply::PortError);
+            ModbusReply reply;
+            reply.id = pending.id;
+            reply.request = pending.request;
+            reply.error = ModbusReply::PortError;
+            emit replyReceived(reply);
+        }
+    }
+}
+
+QString ModbusRtuMaster::exceptionText(quint8 exceptionCode)
+{
+    switch (exceptionCode) {
+    case 0x01: return "非法功能码";
+    case 0x02: return "非法数据地址";
+    case 0x03: return "非法数据值";
+    case 0x04: return "从站设备故障";
+    default: return QString("未知异常码: %1").arg(exceptionCode);
+    }
+}
+
+void ModbusRtuMaster::startNext()
+{
+    if (m_busy) return;
+    // 请求组未发完时接着发组内的下一条，否则取优先级最高的非空通道
+    int lane = m_chainLane;
+    m_chainLane = -1;
+    if (lane < 0 || m_queues[lane].isEmpty()) {
+        lane = 0;
+        while (lane < ModbusRequest::LaneCount && m_queues[lane].isEmpty()) ++lane;
+        if (lane == ModbusRequest::LaneCount) return;
+    }
+
+    m_current = m_queues[lane].dequeue();
+    m_busy = true;
+    LaneStatistics &stats = m_laneStatistics[lane];
+    qint64 waitMs = m_clock.elapsed() - m_current.queuedAtMs;
+    stats.averageWaitMs = stats.completed == 0 ? waitMs
+                                               : stats.averageWaitMs + (waitMs - stats.averageWaitMs) * kLatencySmoothing;
+    stats.maxWaitMs = qMax(stats.maxWaitMs, waitMs);
+    m_transactionTimer.start();
+    if (!m_serialPort->isOpen()) {
+        emit errorOccurred("串口未打开，无法发送指令。");
+        finishCurrent(ModbusReply::PortError);
+        return;
+    }
+    sendCurrent();
+}
+
+void ModbusRtuMaster::sendCurrent()
+{
+    discardReceived(m_receivedBuffer.size()); // 上次发送之后收到的残留数据
+    QByteArray adu = m_current.request.toAdu();
+    m_serialPort->write(adu);
+    ++m_current.attempts;
+    m_responseTimer->start(responseTimeoutFor(m_current.request));
+    emit frameSent(adu);
+}
+
+bool ModbusRtuMaster::retryCurrent(ModbusReply::Error error)
+{
+    // 从站已应答(异常码)或串口不可用时重发没有意义
+    if (error != ModbusReply::TimeoutError && error != ModbusReply::CrcError &&
+        error != ModbusReply::FrameError) {
+        return false;
+    }
+    int maxRetries = m_current.request.maxRetries >= 0 ? m_current.request.maxRetries : m_maxRetries;
+    if (m_current.attempts > maxRetries || !m_serialPort->isOpen()) return false;
+
+    int shift = qMin(m_current.attempts - 1, 16);
+    int backoffMs = qMin(m_maxBackoffMs, m_backoffMs << shift);
+    ModbusReply failed;
+    failed.error = error;
+    emit errorOccurred(QString("%1，%2ms后第%3次重试").arg(failed.errorString()).arg(backoffMs)
+                       .arg(m_current.attempts));
+    ++m_statistics.retries;
+    m_retryTimer->start(backoffMs);
+    return true;
+}
+
+void ModbusRtuMaster::onRetryTimeout()
+{
+    if (!m_busy) return;
+    if (!m_serialPort->isOpen()) {
+        finishCurrent(ModbusReply::PortError);
+        return;
+    }
+    sendCurrent();
+}
+
+void ModbusRtuMaster::finishCurrent(ModbusReply::Error error, const ModbusFrameView &frame,
+                                    quint8 exceptionCode)
+{
+    m_responseTimer->stop();
+    m_retryTimer->stop(); // 退避期间也可能收到迟到的应答
+    if (retryCurrent(error)) {
+        // 错误应答帧不再需要，等待退避后重发
+        clearReceivedBuffer();
+        return;
+    }
+
+    ModbusReply reply;
+    reply.id = m_current.id;
+    reply.request = m_current.request;
+    reply.error = error;
+    reply.exceptionCode = exceptionCode;
+    reply.attempts = m_current.attempts;
+    reply.elapsedMs = m_transactionTimer.elapsed();
+    reply.frame = frame;
+
+    countFinished(m_current, error);
+
+    m_busy = false;
+    m_dispatching = true;
+    emit replyReceived(reply);
+    if (m_current.chained) {
+        // 请求组的剩余部分紧跟在同一通道的队首；分发期间关闭串口时已由 clearQueue() 应答
+        QQueue<PendingRequest> &queue = m_queues[m_current.request.lane];
+        quint32 nextId = m_current.id + 1 == 0 ? 1 : m_current.id + 1;
+        bool chained = !queue.isEmpty() && queue.head().id == nextId;
+        if (chained && error == ModbusReply::NoError) {
+            m_chainLane = m_current.request.lane;
+            chained = false;
+        }
+        while (chained && !queue.isEmpty()) {
+            PendingRequest pending = queue.dequeue();
+            chained = pending.chained;
+            countFinished(pending, error);
+            ModbusReply skipped;
+            skipped.id = pending.id;
+            skipped.request = pending.request;
+            skipped.error = error;
+            skipped.exceptionCode = exceptionCode;
+            emit replyReceived(skipped);
+        }
+    }
+    m_dispatching = false;
+
+    // 应答视图指向接收缓冲区，分发完毕后才能丢弃
+    clearReceivedBuffer();
+    startNext();
+}
+
+void ModbusRtuMaster::countFinished(const PendingRequest &pending, ModbusReply::Error error)
+{
+    ++m_statistics.transactions;
+    switch (error) {
+    case ModbusReply::NoError: ++m_statistics.ok; break;
+    case ModbusReply::ExceptionError: ++m_statistics.exceptions; break;
+    case ModbusReply::CrcError: ++m_statistics.crcErrors; break;
+    case ModbusReply::FrameError: ++m_statistics.frameErrors; break;
+    case ModbusReply::TimeoutError: ++m_statistics.timeouts; break;
+    case ModbusReply::PortError: ++m_statistics.portErrors; break;
+    }
+    LaneStatistics &stats = m_laneStatistics[pending.request.lane];
+    qint64 latencyMs = m_clock.elapsed() - pending.queuedAtMs;
+    stats.averageLatencyMs = stats.completed == 0 ? latencyMs
+                                                  : stats.averageLatencyMs + (latencyMs - stats.averageLatencyMs) * kLatencySmoothing;
+    ++stats.completed;
+    stats.maxLatencyMs = qMax(stats.maxLatencyMs, latencyMs);
+}
+
+void ModbusRtuMaster::clearReceivedBuffer()
+{
+    m_receivedBuffer.clear();
+    m_receivedCrc.reset();
+    m_crcLength = 0;
+}
+
+void ModbusRtuMaster::discardReceived(int length)
+{
+    if (length <= 0) return;
+    m_discardedBytes += length;
+    emit errorOccurred(QString("丢弃无效数据 %1 字节").arg(length));
+    m_receivedBuffer.skip(length);
+    // 增量CRC只对缓冲区开头的候选帧有效
+    m_receivedCrc.reset();
+    m_crcLength = 0;
+}
+
+int ModbusRtuMaster::silenceIntervalMs() const
+{
+    if (m_frameTimeoutMs > 0) return m_frameTimeoutMs;
+
+    // Modbus RTU 规定每字符按11位计: t3.5 = 3.5 * 11 / 波特率；
+    // 波特率高于19200时固定为1.75ms。以定时器精度为下限
+    qint32 baud = m_serialPort->baudRate();
+    double t35Ms = baud > 19200 || baud <= 0 ? 1.75 : 3.5 * 11 * 1000.0 / baud;
+    return qMax(kMinSilenceMs, static_cast<int>(t35Ms + 0.999));
+}
+
+int ModbusRtuMaster::expectedFrameLength(const SerialRingBuffer &buffer, int offset)
+{
+    int available = buffer.size() - offset;
+    if (available < 2) return 0;
+
+    quint8 functionCode = buffer.at(offset + 1);
+    if (functionCode & 0x80) return 5;
+    switch (functionCode) {
+    case 0x01:
+    case 0x02:
+    case 0x03:
+    case 0x04:
+        if (available < 3) return 0;
+        return 3 + buffer.at(offset + 2) + 2;
+    case 0x05:
+    case 0x06:
+    case 0x0F:
+    case 0x10:
+        return 8;
+    default:
+        return -1;
+    }
+}
+
+bool ModbusRtuMaster::isResponseHeader(int offset) const
+{
+    const ModbusRequest &request = m_current.request;
+    if (offset >= m_receivedBuffer.size() || m_receivedBuffer.at(offset) != request.slaveId) return false;
+    // 功能码尚未收到时先按候选帧头处理
+    return offset + 1 >= m_receivedBuffer.size() ||
+           (m_receivedBuffer.at(offset + 1) & 0x7F) == request.functionCode;
+}
+
+bool ModbusRtuMaster::resync(bool silenceElapsed)
+{
+    // 逐字节滑动，寻找地址、功能码与当前请求一致、帧长已收满且CRC通过的位置。
+    // 噪声字节可能恰好像帧头并给出错误的长度，因此未收全的候选不阻塞后面的查找
+    int size = m_receivedBuffer.size();
+    int firstHeader = -1;  // 第一个可能的帧头
+    int corruptOffset = -1;
+    int corruptLength = 0;
+    for (int offset = 0; offset < size; ++offset) {
+        if (!isResponseHeader(offset)) continue;
+        if (firstHeader < 0) firstHeader = offset;
+
+        int length = expectedFrameLength(m_receivedBuffer, offset);
+        if (length < 0) {
+            // 未知功能码无法推算帧长，静默后以剩余数据为一帧
+            if (!silenceElapsed) continue;
+            length = size - offset;
+        }
+        if (length == 0 || offset + length > size || length > SerialRingBuffer::MaxViewLength) continue;
+
+        ModbusFrameView candidate = m_receivedBuffer.peek(offset, length);
+        if (!ModbusCrc::checkFrame(candidate.data(), candidate.size())) {
+            if (corruptOffset < 0) {
+                corruptOffset = offset;
+                corruptLength = length;
+            }
+            continue;
+        }
+
+        discardReceived(offset);
+        processFrame(length);
+        return true;
+    }
+
+    // 静默后仍无有效帧: 帧长完整但CRC错误的候选按校验错误上报
+    if (silenceElapsed && corruptOffset >= 0) {
+        discardReceived(corruptOffset);
+        processFrame(corruptLength);
+        return true;
+    }
+
+    // 只丢弃第一个可能的帧头之前的字节，其余等待后续数据
+    discardReceived(firstHeader < 0 ? size : firstHeader);
+    return false;
+}
+
+void ModbusRtuMaster::onReadyRead()
+{
+    // 直接读入环形缓冲区，不经过 readAll() 的临时 QByteArray
+    m_receivedBuffer.readFrom(m_serialPort);
+    if (m_receivedBuffer.freeSpace() == 0) {
+        emit errorOccurred("接收缓冲区已满，清空缓冲区");
+        discardReceived(m_receivedBuffer.size());
+        m_serialPort->clear(QSerialPort::Input);
+        return;
+    }
+    if (!m_busy || m_framingMode != LengthFraming) {
+        m_frameTimer->start();
+        return;
+    }
+
+    // 开头是噪声字节时先滑动重同步，只丢弃无效前缀
+    if (!isResponseHeader(0) && resync(false)) return;
+
+    // 按功能码/字节数推算帧长，收满且CRC通过即完成，无需等待静默
+    int expected = expectedFrameLength(m_receivedBuffer);
+    if (expected > 0 && expected <= SerialRingBuffer::MaxViewLength) {
+        int available = qMin(expected, m_receivedBuffer.size());
+        ModbusFrameView pending = m_receivedBuffer.peek(m_crcLength, available - m_crcLength);
+        m_receivedCrc.addData(pending.data(), pending.size());
+        m_crcLength = available;
+        if (available == expected) {
+            if (m_receivedCrc.value() == 0) {
+                processFrame(expected);
+                return;
+            }
+            // 帧长已满但CRC不符: 开头可能是伪帧头，向后查找真正的应答
+            if (resync(false)) return;
+        }
+    }
+    m_frameTimer->start();
+}
+
+void ModbusRtuMaster::onFrameTimeout()
+{
+    if (m_receivedBuffer.isEmpty()) return;
+
+    if (!m_busy) {
+        discardReceived(m_receivedBuffer.size()); // 未请求的数据
+        return;
+    }
+
+    // t3.5 静默: 查找有效帧；只剩未收全的候选帧头时继续等待直到应答超时
+    if (resync(true)) return;
+
+    if (m_receivedBuffer.size() > kMaxAduLength) {
+        emit errorOccurred("接收缓冲区过大，清空缓冲区");
+        discardReceived(m_receivedBuffer.size());
+        finishCurrent(ModbusReply::FrameError);
+    }
+}
+
+void ModbusRtuMaster::processFrame(int length)
+{
+    m_frameTimer->stop();
+
+    // 帧以视图形式留在接收缓冲区中，直到应答分发完毕
+    ModbusFrameView frame = m_receivedBuffer.peek(0, length);
+    if (m_receivedBuffer.size() > length) {
+        int extra = m_receivedBuffer.size() - length;
+        m_discardedBytes += extra;
+        emit errorOccurred(QString("丢弃帧尾多余数据 %1 字节").arg(extra));
+    }
+
+    // 整帧(含CRC)的CRC余数为0即校验通过；长度帧模式下接收时已增量计算完毕
+    bool crcOk = m_crcLength == length ? m_receivedCrc.value() == 0
+                                       : ModbusCrc::checkFrame(frame.data(), frame.size());
+    emit frameReceived(frame);
+
+    if (length < 4 || !crcOk) {
+        finishCurrent(ModbusReply::CrcError, frame);
+        return;
+    }
+
+    const ModbusRequest &request = m_current.request;
+    quint8 address = frame.at(0);
+    quint8 functionCode = frame.at(1);
+    if (address != request.slaveId || (functionCode & 0x7F) != request.functionCode) {
+        finishCurrent(ModbusReply::FrameError, frame);
+        return;
+    }
+
+    if (functionCode & 0x80) {
+        finishCurrent(ModbusReply::ExceptionError, frame, frame.at(2));
+        return;
+    }
+
+    int expected = request.expectedResponseLength();
+    if (expected > 0 && frame.size() != expected) {
+        finishCurrent(ModbusReply::FrameError, frame);
+        return;
+    }
+
+    finishCurrent(ModbusReply::NoError, frame);
+}
+
+void ModbusRtuMaster::onResponseTimeout()
+{
+    if (!m_busy) return;
+    m_frameTimer->stop();
+    discardReceived(m_receivedBuffer.size());
+    finishCurrent(ModbusReply::TimeoutError);
+}
+
+void ModbusRtuMaster::onSerialError(QSerialPort::SerialPortError error)
+{
+    if (error == QSerialPort::NoError) return;
+    emit errorOccurred("串口错误: " + m_serialPort->errorString());
+
+    // 适配器拔出、无权限等错误后串口不可恢复，当前事务和排队的请求立即以串口错误结束，
+    // 不再等应答超时后按超时重试
+    if (error == QSerialPort::ResourceError || error == QSerialPort::PermissionError
+            || error == QSerialPort::DeviceNotFoundError) {
+        close();
+    }
+}
@@ -0,0 +1,236 @@
+#ifndef MODBUSRTUMASTER_H
+#define MODBUSRTUMASTER_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QByteArray>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include "modbuscrc.h"
+#include "modbusframeview.h"
+#include "serialringbuffer.h"
+
+class QTimer;
+
+// Modbus RTU 请求: 从站地址 + 功能码 + 功能码之后的PDU数据(不含CRC)
+struct ModbusRequest
+{
+    // 主站队列的优先通道，数值小的先发；同一通道内先进先出
+    enum Lane {
+        InteractiveLane, // 前端/页面的按需操作
+        AlarmLane,       // 报警后的补充读取
+        PeriodicLane,    // 周期轮询
+        DiscoveryLane,   // 从站探测等后台任务
+        LaneCount
+    };
+
+    quint8 slaveId = 0;
+    quint8 functionCode = 0;
+    QByteArray data;
+    int tag = 0; // 调用方自定义标记，随应答原样带回
+    int timeoutMs = 0;   // 应答超时，0 表示按波特率和应答长度计算
+    int maxRetries = -1; // 超时/校验失败后的重试次数，-1 表示使用主站设置
+    Lane lane = InteractiveLane;
+
+    static ModbusRequest readHoldingRegisters(quint8 slaveId, quint16 address, quint16 count);
+    static ModbusRequest readInputRegisters(quint8 slaveId, quint16 address, quint16 count);
+    static ModbusRequest writeSingleRegister(quint8 slaveId, quint16 address, quint16 value);
+
+    // 组装带CRC的完整发送帧
+    QByteArray toAdu() const;
+    // 正常应答帧的预期长度，无法预知时返回 -1
+    int expectedResponseLength() const;
+};
+
+// 一次事务的结果
+struct ModbusReply
+{
+    enum Error {
+        NoError,
+        ExceptionError, // 从站返回异常码
+        CrcError,
+        FrameError,     // 地址/功能码不匹配或长度错误
+        TimeoutError,
+        PortError
+    };
+
+    quint32 id = 0;
+    ModbusRequest request;
+    Error error = NoError;
+    quint8 exceptionCode = 0;
+    int attempts = 0;     // 实际发送次数(含重试)
+    qint64 elapsedMs = 0; // 从首次发送到事务结束的耗时
+    // 完整应答帧(含CRC)，指向主站接收缓冲区，仅在 replyReceived 分发期间有效
+    ModbusFrameView frame;
+    // 合并读取拆分给各任务时，payload() 只取数据区中的这一段(字节)；长度 -1 表示整个数据区
+    int payloadOffset = 0;
+    int payloadLength = -1;
+
+    bool isValid() const { return error == NoError; }
+    // 读寄存器应答的数据区(字节数之后、CRC之前)，同样为视图
+    ModbusFrameView payload() const;
+    QString errorString() const;
+    // 事务结果的简短英文名(ok/timeout/crc/exception/frame/port)，用于统计和JSON
+    QString outcomeName() const;
+};
+Q_DECLARE_METATYPE(ModbusReply)
+
+// 与界面无关的 Modbus RTU 主站: 串口、请求队列、帧接收、CRC、异常码解码与应答分发。
+// 请求按 ModbusRequest::lane 分通道排队，空闲时先发优先级高的通道，页面和前端的按需读取
+// 不会排在周期轮询之后；各通道有最大排队数和等待/延迟统计。
+class ModbusRtuMaster : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 帧接收方式
+    enum FramingMode {
+        LengthFraming,  // 按功能码/字节数推算帧长，收满且CRC通过立即完成，t3.5静默兜底
+        TimeoutFraming  // 仅以静默超时判断帧结束(兼容不规范的网关)
+    };
+
+    explicit ModbusRtuMaster(QObject *parent = nullptr);
+    ~ModbusRtuMaster();
+
+    // 以 8N1、无流控方式打开串口
+    bool open(const QString &portName, qint32 baudRate);
+    void close();
+    bool isOpen() const;
+    QString portName() const;
+    qint32 baudRate() const;
+    QString errorString() const;
+
+    // 是否有尚未完成的事务
+    bool isBusy() const;
+    int pendingCount() const;
+    // 重同步等原因累计丢弃的接收字节数
+    quint64 discardedBytes() const;
+
+    void setFramingMode(FramingMode mode);
+    FramingMode framingMode() const;
+    // 帧结束静默时间，0 表示按波特率自动计算 t3.5
+    void setFrameTimeout(int ms);
+    // 固定应答超时，0(默认)表示按请求逐个计算，见 responseTimeoutFor()
+    void setResponseTimeout(int ms);
+    // 自动计算超时时预留的从站处理及USB转串口延迟
+    void setTurnaroundTime(int ms);
+    // 超时、CRC错误或帧错误时重试 maxRetries 次，第n次重试前等待
+    // backoffMs * 2^(n-1)，不超过 maxBackoffMs。异常应答和串口错误不重试
+    void setRetryPolicy(int maxRetries, int backoffMs, int maxBackoffMs);
+    // 单次发送的应答期限: 请求和应答的传输时间 + t3.5 + 从站处理时间
+    int responseTimeoutFor(const ModbusRequest &request) const;
+    // 一次事务(不含重试)预计占用总线的时间: 请求和应答的传输时间 + 两次 t3.5 + 从站处理时间
+    double airtimeMs(const ModbusRequest &request) const;
+
+    // 各类事务结果的累计次数
+    struct Statistics {
+        quint64 transactions = 0;
+        quint64 ok = 0;
+        quint64 timeouts = 0;
+        quint64 crcErrors = 0;
+        quint64 frameErrors = 0;
+        quint64 exceptions = 0;
+        quint64 portErrors = 0;
+        quint64 retries = 0;
+    };
+    Statistics statistics() const;
+
+    // 单个优先通道的队列统计。等待时间为入队到首次发送，延迟为入队到事务结束
+    struct LaneStatistics {
+        quint64 completed = 0;
+        quint64 rejected = 0;       // 队列满被拒绝的请求
+        int queued = 0;             // 当前排队数
+        int maxDepth = 0;
+        double averageWaitMs = 0;   // 滑动平均
+        qint64 maxWaitMs = 0;
+        double averageLatencyMs = 0;
+        qint64 maxLatencyMs = 0;
+    };
+    LaneStatistics laneStatistics(ModbusRequest::Lane lane) const;
+    // 通道的最大排队数，超出时拒绝新请求
+    void setLaneDepth(ModbusRequest::Lane lane, int maxDepth);
+    static QString laneName(ModbusRequest::Lane lane);
+
+    // 请求按通道入队，返回事务编号；串口空闲时立即发送。
+    // 通道已满时不入队，发出 errorOccurred 并返回 0
+    quint32 sendRequest(const ModbusRequest &request);
+    // 一组必须连续完成的请求(如先写设备选择寄存器再读数据)，全部排入首条请求的通道。
+    // 前一条成功后立即发下一条，中间不插入任何通道的其他请求；前一条失败时后续请求不再发送，
+    // 以同样的错误逐条应答。通道放不下整组时全部拒绝并返回空列表，否则按顺序返回各事务编号
+    QList<quint32> sendChain(const QList<ModbusRequest> &requests);
+    void clearQueue();
+
+    static QString exceptionText(quint8 exceptionCode);
+
+signals:
+    // 应答与接收帧均以视图指向接收缓冲区，只能直接连接，槽函数返回后即失效
+    void replyReceived(const ModbusReply &reply);
+    void frameSent(const QByteArray &frame);
+    void frameReceived(const ModbusFrameView &frame);
+    void errorOccurred(const QString &message);
+
+private slots:
+    void onReadyRead();
+    void onFrameTimeout();
+    void onResponseTimeout();
+    void onRetryTimeout();
+    void onSerialError(QSerialPort::SerialPortError error);
+
+private:
+    struct PendingRequest {
+        quint32 id;
+        ModbusRequest request;
+        int attempts;
+        qint64 queuedAtMs; // 入队时刻(m_clock)
+        bool chained;      // 同一通道中紧随其后的请求属于同一组，须接着发送
+    };
+
+    // 由 offset 处已收到的帧头推算帧长: 0 表示帧头未收全，-1 表示未知功能码
+    static int expectedFrameLength(const SerialRingBuffer &buffer, int offset = 0);
+    // offset 处的地址、功能码是否与当前请求匹配
+    bool isResponseHeader(int offset) const;
+    // 滑动查找有效应答帧并丢弃其前的无效字节，找到并处理后返回 true
+    bool resync(bool silenceElapsed);
+    int silenceIntervalMs() const;
+    void clearReceivedBuffer();
+    void discardReceived(int length);
+    void processFrame(int length);
+    quint32 enqueue(const ModbusRequest &request, ModbusRequest::Lane lane, bool chained);
+    void startNext();
+    void sendCurrent();
+    bool retryCurrent(ModbusReply::Error error);
+    void finishCurrent(ModbusReply::Error error, const ModbusFrameView &frame = ModbusFrameView(),
+                       quint8 exceptionCode = 0);
+    // 事务结束(包括未发送就以错误应答的请求)计入总计数和所在通道的完成数、延迟
+    void countFinished(const PendingRequest &pending, ModbusReply::Error error);
+
+    QSerialPort *m_serialPort;
+    QTimer *m_frameTimer;    // 帧间静默(t3.5)定时器
+    QTimer *m_responseTimer; // 应答超时定时器
+    QTimer *m_retryTimer;    // 重试退避定时器
+    FramingMode m_framingMode;
+    int m_frameTimeoutMs;
+    int m_responseTimeoutMs;
+    int m_turnaroundMs;
+    int m_maxRetries;
+    int m_backoffMs;
+    int m_maxBackoffMs;
+    SerialRingBuffer m_receivedBuffer;
+    ModbusCrc m_receivedCrc; // 随字节到达增量计算的接收CRC
+    int m_crcLength;         // m_receivedCrc 已覆盖的字节数
+
+    QQueue<PendingRequest> m_queues[ModbusRequest::LaneCount];
+    LaneStatistics m_laneStatistics[ModbusRequest::LaneCount];
+    QElapsedTimer m_clock;
+    PendingRequest m_current;
+    QElapsedTimer m_transactionTimer;
+    bool m_busy;
+    bool m_dispatching; // 正在分发应答
+    int m_chainLane;    // 当前请求组剩余部分所在的通道，-1 表示没有
+    quint32 m_nextId;
+    quint64 m_discardedBytes;
+    Statistics m_statistics;
+};
+
+#endif // MODBUSRTUMASTER_H
@@ -0,0 +1,38 @@
+#include "partialdischargemonitor.h"
+#include <QDateTime>
+
+PartialDischargeMonitor::PartialDischargeMonitor(QObject *parent) :
+    DeviceMonitor(DeviceKind::PartialDischarge, 8081, parent)
+{
+    setReadParameters(1, 0x0065, 0x000B);
+}
+
+QJsonObject PartialDischargeMonitor::sampleToJson(const DeviceSample &sample) const
+{
+    QJsonObject json;
+    json["slaveId"] = sample.slaveId;
+    json["time"] = QDateTime::fromSecsSinceEpoch(sample.deviceTime).toString("yyyy-MM-dd hh:mm:ss");
+    json["type"] = static_cast<int>(sample.values[DeviceSample::PdType]);
+    json["frequency"] = static_cast<int>(sample.values[DeviceSample::PdFrequency]);
+    json["totalCount"] = QString::number(static_cast<quint32>(sample.values[DeviceSample::PdTotalCount]));
+    json["amount"] = sample.formattedValue(DeviceSample::PdAmount).toDouble();
+    json["strength"] = static_cast<int>(sample.values[DeviceSample::PdStrength]);
+    json["hasSignal"] = sample.values[DeviceSample::PdHasSignal] == 1 ? "有信号" : "无信号";
+    json["commStatus"] = sample.values[DeviceSample::PdCommStatus] == 0 ? "正常" : "异常";
+    json["alarmStatus"] = sample.values[DeviceSample::PdAlarmStatus] == 0 ? "无报警" : "报警";
+    json["id"] = sample.timestampMs;
+    return json;
+}
+
+bool PartialDischargeMonitor::decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const
+{
+    return DeviceSample::decodePartialDischarge(payload, slaveId, sample);
+}
+
+QString PartialDischargeMonitor::describeSample(const DeviceSample &sample) const
+{
+    return QString("局放数据解析完成 - 时间:%1, 幅值:%2 pC, 强度:%3")
+            .arg(QDateTime::fromSecsSinceEpoch(sample.deviceTime).toString("yyyy-MM-dd hh:mm:ss"))
+            .arg(sample.formattedValue(DeviceSample::PdAmount))
+            .arg(sample.values[DeviceSample::PdStrength]);
+}
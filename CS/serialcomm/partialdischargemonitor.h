@@ -0,0 +1,23 @@
+#ifndef PARTIALDISCHARGEMONITOR_H
+#define PARTIALDISCHARGEMONITOR_H
+
+#include "devicemonitor.h"
+
+// 变压器局放: 读保持寄存器前写入设备码 0x5209 选中设备。WebSocket 默认端口 8081
+class PartialDischargeMonitor : public DeviceMonitor
+{
+    Q_OBJECT
+
+public:
+    explicit PartialDischargeMonitor(QObject *parent = nullptr);
+
+    QJsonObject sampleToJson(const DeviceSample &sample) const override;
+
+protected:
+    int deviceCode() const override { return 0x5209; }
+    int minimumPayloadSize() const override { return 22; }
+    bool decode(const ModbusFrameView &payload, quint8 slaveId, DeviceSample *sample) const override;
+    QString describeSample(const DeviceSample &sample) const override;
+};
+
+#endif // PARTIALDISCHARGEMONITOR_H
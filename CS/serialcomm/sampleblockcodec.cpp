@@ -0,0 +1,116 @@
+#include "sampleblockcodec.h"
+
+QByteArray SampleBlockCodec::encode(const QVector<DeviceSample> &samples)
+{
+    QByteArray block;
+    if (samples.isEmpty()) return block;
+    const DeviceSample &first = samples.first();
+    const int valueCount = qBound(0, first.valueCount, int(DeviceSample::MaxValues));
+    // 大多数值 1~2 字节，按此预留，避免反复扩容
+    block.reserve(HeaderSize + 10 + samples.size() * (2 + valueCount) * 2);
+    block.append(char(Version));
+    block.append(char(first.kind));
+    block.append(char(first.slaveId));
+    block.append(char(valueCount));
+    writeVarint(&block, quint64(samples.size()));
+
+    // 差分按无符号回绕计算，极端值也能无损还原
+    qint64 previous = 0;
+    qint64 previousDelta = 0;
+    for (int i = 0; i < samples.size(); ++i) {
+        qint64 delta = qint64(quint64(samples[i].timestampMs) - quint64(previous));
+        writeVarint(&block, zigzag(i < 2 ? delta : qint64(quint64(delta) - quint64(previousDelta))));
+        previous = samples[i].timestampMs;
+        previousDelta = delta;
+    }
+
+    previous = 0;
+    for (const DeviceSample &sample : samples) {
+        writeVarint(&block, zigzag(qint64(quint64(sample.deviceTime) - quint64(previous))));
+        previous = sample.deviceTime;
+    }
+
+    for (int field = 0; field < valueCount; ++field) {
+        previous = 0;
+        for (const DeviceSample &sample : samples) {
+            qint64 value = field < sample.valueCount ? sample.values[field] : 0;
+            writeVarint(&block, zigzag(qint64(quint64(value) - quint64(previous))));
+            previous = value;
+        }
+    }
+    return block;
+}
+
+bool SampleBlockCodec::decode(const QByteArray &block, QVector<DeviceSample> *samples)
+{
+    samples->clear();
+    if (block.size() < HeaderSize || quint8(block.at(0)) != Version) return false;
+    const uchar *p = reinterpret_cast<const uchar *>(block.constData());
+    const uchar *end = p + block.size();
+    const DeviceKind kind = static_cast<DeviceKind>(p[1]);
+    const quint8 slaveId = p[2];
+    const int valueCount = p[3];
+    if (valueCount > DeviceSample::MaxValues) return false;
+    p += HeaderSize;
+
+    quint64 count = 0;
+    // 每条样本每列至少 1 字节，以此排除损坏的条数
+    if (!readVarint(&p, end, &count) || count > quint64(end - p)) return false;
+    samples->resize(int(count));
+    for (DeviceSample &sample : *samples) {
+        sample.kind = kind;
+        sample.slaveId = slaveId;
+        sample.valueCount = valueCount;
+    }
+
+    quint64 encoded = 0;
+    quint64 previous = 0;
+    quint64 previousDelta = 0;
+    for (int i = 0; i < samples->size(); ++i) {
+        if (!readVarint(&p, end, &encoded)) return false;
+        quint64 delta = i < 2 ? quint64(unzigzag(encoded)) : previousDelta + quint64(unzigzag(encoded));
+        previous += delta;
+        previousDelta = delta;
+        (*samples)[i].timestampMs = qint64(previous);
+    }
+
+    previous = 0;
+    for (DeviceSample &sample : *samples) {
+        if (!readVarint(&p, end, &encoded)) return false;
+        previous += quint64(unzigzag(encoded));
+        sample.deviceTime = qint64(previous);
+    }
+
+    for (int field = 0; field < valueCount; ++field) {
+        previous = 0;
+        for (DeviceSample &sample : *samples) {
+            if (!readVarint(&p, end, &encoded)) return false;
+            previous += quint64(unzigzag(encoded));
+            sample.values[field] = qint64(previous);
+        }
+    }
+    return p == end;
+}
+
+void SampleBlockCodec::writeVarint(QByteArray *out, quint64 value)
+{
+    while (value >= 0x80) {
+        out->append(char(value | 0x80));
+        value >>= 7;
+    }
+    out->append(char(value));
+}
+
+bool SampleBlockCodec::readVarint(const uchar **p, const uchar *end, quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        const uchar byte = *(*p)++;
+        result |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
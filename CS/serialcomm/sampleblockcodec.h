@@ -0,0 +1,40 @@
+#ifndef SAMPLEBLOCKCODEC_H
+#define SAMPLEBLOCKCODEC_H
+
+#include <QByteArray>
+#include <QVector>
+#include "devicesample.h"
+
+// 同一通道(设备 + 从站)一组样本的列式压缩块，思路同 Gorilla 时序压缩:
+// 时间按列存放，接收时间用二阶差分(delta-of-delta)，设备时间和各字段数值用一阶差分，
+// 差分值 zigzag 后写成变长整数(LEB128，每字节 7 位)。
+// 采集周期固定时二阶差分几乎都是 0，缓慢变化的温度/压力/电流、单调递增的计数差分都很小，
+// 多数值只占 1 字节。字段本身是缩放后的整数，差分无损，不需要浮点数的 XOR 编码。
+// SampleLog 的封存分段和 GET_HISTORY 的 "encoding":"block" 都使用这种块。
+//
+// 块格式:
+//   0     1  版本(0x81，最高位与 SampleCodec 的单条记录区分)
+//   1     1  设备类型(DeviceKind)
+//   2     1  从站地址
+//   3     1  字段数 n
+//   4     …  样本数(varint)
+//         …  接收时间: 首个值、首个差分、其后各二阶差分(zigzag varint)
+//         …  设备时间列、字段 0 … n-1 列: 各列相对前一个值的差分(zigzag varint)，首个相对 0
+class SampleBlockCodec
+{
+public:
+    enum { Version = 0x81, HeaderSize = 4 };
+
+    // samples 须属于同一通道，种类、从站和字段数取第一条
+    static QByteArray encode(const QVector<DeviceSample> &samples);
+    // 格式错误或数据截断时返回 false
+    static bool decode(const QByteArray &block, QVector<DeviceSample> *samples);
+
+private:
+    static void writeVarint(QByteArray *out, quint64 value);
+    static bool readVarint(const uchar **p, const uchar *end, quint64 *value);
+    static quint64 zigzag(qint64 value) { return (quint64(value) << 1) ^ quint64(value >> 63); }
+    static qint64 unzigzag(quint64 value) { return qint64(value >> 1) ^ -qint64(value & 1); }
+};
+
+#endif // SAMPLEBLOCKCODEC_H
@@ -0,0 +1,111 @@
+#include "samplecodec.h"
+#include <QJsonArray>
+#include <QtEndian>
+#include <limits>
+
+quint8 SampleCodec::fieldMask(DeviceKind kind, const QStringList &fields)
+{
+    if (fields.isEmpty()) return AllFields;
+    int count = 0;
+    const DeviceField *descriptors = DeviceSample::fields(kind, &count);
+    quint8 mask = 0;
+    for (int i = 0; i < count; ++i) {
+        if (fields.contains(QLatin1String(descriptors[i].key))) mask |= 1u << i;
+    }
+    return mask;
+}
+
+QByteArray SampleCodec::encode(const DeviceSample &sample, quint8 mask)
+{
+    int count = qMin<int>(sample.valueCount, DeviceSample::MaxValues);
+    if (count < 8) mask &= (1u << count) - 1;
+
+    // 数值超出 int32 时整条记录改用 int64
+    int selected = 0;
+    bool wide = false;
+    for (int i = 0; i < count; ++i) {
+        if (!(mask & (1u << i))) continue;
+        ++selected;
+        if (sample.values[i] < std::numeric_limits<qint32>::min()
+                || sample.values[i] > std::numeric_limits<qint32>::max()) {
+            wide = true;
+        }
+    }
+    const int valueSize = wide ? 8 : 4;
+
+    QByteArray record(HeaderSize + selected * valueSize, '\0');
+    uchar *p = reinterpret_cast<uchar *>(record.data());
+    p[0] = Version;
+    p[1] = static_cast<uchar>(sample.kind);
+    p[2] = sample.slaveId;
+    p[3] = wide ? WideValues : 0;
+    p[4] = mask;
+    qToLittleEndian<qint64>(sample.timestampMs, p + 8);
+    qToLittleEndian<quint32>(static_cast<quint32>(sample.deviceTime), p + 16);
+
+    p += HeaderSize;
+    for (int i = 0; i < count; ++i) {
+        if (!(mask & (1u << i))) continue;
+        if (wide) {
+            qToLittleEndian<qint64>(sample.values[i], p);
+        } else {
+            qToLittleEndian<qint32>(static_cast<qint32>(sample.values[i]), p);
+        }
+        p += valueSize;
+    }
+    return record;
+}
+
+bool SampleCodec::decode(const QByteArray &record, DeviceSample *sample, quint8 *mask)
+{
+    if (record.size() < HeaderSize) return false;
+    const uchar *p = reinterpret_cast<const uchar *>(record.constData());
+    if (p[0] != Version) return false;
+
+    const quint8 fieldMask = p[4];
+    const int valueSize = (p[3] & WideValues) ? 8 : 4;
+    int selected = 0;
+    for (int i = 0; i < DeviceSample::MaxValues; ++i) {
+        if (fieldMask & (1u << i)) ++selected;
+    }
+    if (record.size() != HeaderSize + selected * valueSize) return false;
+
+    *sample = DeviceSample();
+    sample->kind = static_cast<DeviceKind>(p[1]);
+    sample->slaveId = p[2];
+    sample->timestampMs = qFromLittleEndian<qint64>(p + 8);
+    sample->deviceTime = qFromLittleEndian<quint32>(p + 16);
+    DeviceSample::fields(sample->kind, &sample->valueCount);
+
+    p += HeaderSize;
+    for (int i = 0; i < DeviceSample::MaxValues; ++i) {
+        if (!(fieldMask & (1u << i))) continue;
+        if (i >= sample->valueCount) return false;
+        sample->values[i] = valueSize == 8 ? qFromLittleEndian<qint64>(p) : qFromLittleEndian<qint32>(p);
+        p += valueSize;
+    }
+    if (mask) *mask = fieldMask;
+    return true;
+}
+
+QJsonObject SampleCodec::schema()
+{
+    QJsonObject schema;
+    const DeviceKind kinds[] = { DeviceKind::IronCore, DeviceKind::PartialDischarge, DeviceKind::MicroWater };
+    for (DeviceKind kind : kinds) {
+        int count = 0;
+        const DeviceField *descriptors = DeviceSample::fields(kind, &count);
+        QJsonArray fields;
+        for (int i = 0; i < count; ++i) {
+            QJsonObject field;
+            field["key"] = QString::fromLatin1(descriptors[i].key);
+            field["decimals"] = descriptors[i].decimals;
+            fields.append(field);
+        }
+        QJsonObject device;
+        device["kind"] = static_cast<int>(kind);
+        device["fields"] = fields;
+        schema[DeviceSample::kindName(kind)] = device;
+    }
+    return schema;
+}
@@ -0,0 +1,40 @@
+#ifndef SAMPLECODEC_H
+#define SAMPLECODEC_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+#include "devicesample.h"
+
+// WebSocket 二进制数据格式(连接协商 "binary" 后使用)，所有整数小端:
+//   偏移  长度  内容
+//   0     1     版本，当前为 1
+//   1     1     设备类型(DeviceKind)
+//   2     1     从站地址
+//   3     1     标志: bit0 = 数值为 int64，否则为 int32
+//   4     1     字段掩码: bit i 表示包含第 i 个字段，数值按字段顺序排列
+//   5     3     保留，为 0
+//   8     8     接收时间(毫秒时间戳, int64)
+//   16    4     设备上报时间(秒, uint32)，无则为 0
+//   20    4或8  各字段原始整数值，实际值 = 原始值 / 10^decimals
+// 字段名和小数位见 schema()，协商成功时随回复下发。
+class SampleCodec
+{
+public:
+    enum {
+        Version = 1,
+        HeaderSize = 20,
+        WideValues = 0x01,
+        AllFields = 0xFF
+    };
+
+    // 字段名 -> 字段掩码，fields 为空表示全部字段
+    static quint8 fieldMask(DeviceKind kind, const QStringList &fields);
+    static QByteArray encode(const DeviceSample &sample, quint8 mask = AllFields);
+    // encode() 的逆过程，未包含的字段置 0，*mask 为记录中的字段掩码；格式错误时返回 false
+    static bool decode(const QByteArray &record, DeviceSample *sample, quint8 *mask = nullptr);
+    // 各设备的字段名与小数位: {"microWater":{"kind":3,"fields":[{"key":"temperature","decimals":2},...]},...}
+    static QJsonObject schema();
+};
+
+#endif // SAMPLECODEC_H
@@ -0,0 +1,139 @@
+#include "sampleexport.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "samplehistory.h"
+
+SampleExport::SampleExport(SampleLog *log, Format format, qint64 fromMs, qint64 toMs,
+                           const QStringList &channels) :
+    m_log(log),
+    m_format(format),
+    m_fromMs(fromMs),
+    m_toMs(toMs),
+    m_channels(channels),
+    m_atEnd(false),
+    m_headerWritten(false),
+    m_rows(0)
+{
+    m_timer.start();
+    if (m_format != Csv) return;
+
+    const DeviceKind kinds[] = { DeviceKind::IronCore, DeviceKind::PartialDischarge, DeviceKind::MicroWater };
+    for (DeviceKind kind : kinds) {
+        const QString name = DeviceSample::kindName(kind);
+        bool selected = m_channels.isEmpty();
+        for (const QString &channel : m_channels) {
+            if (channel == name || channel.startsWith(name + ':')) selected = true;
+        }
+        if (!selected) continue;
+
+        int count = 0;
+        const DeviceField *descriptors = DeviceSample::fields(kind, &count);
+        QVector<int> &columnOf = m_columnOf[static_cast<int>(kind)];
+        for (int field = 0; field < count; ++field) {
+            const QString key = QString::fromLatin1(descriptors[field].key);
+            int column = m_columns.indexOf(key);
+            if (column < 0) {
+                column = m_columns.size();
+                m_columns.append(key);
+            }
+            columnOf.append(column);
+        }
+    }
+}
+
+bool SampleExport::formatFromName(const QString &name, Format *format)
+{
+    if (name == "csv") {
+        *format = Csv;
+    } else if (name == "ndjson") {
+        *format = NdJson;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString SampleExport::formatName(Format format)
+{
+    return format == Csv ? QStringLiteral("csv") : QStringLiteral("ndjson");
+}
+
+QString SampleExport::nextChunk(int maxRecords, qint64 *rows)
+{
+    QString out;
+    qint64 chunkRows = 0;
+    if (m_format == Csv && !m_headerWritten) {
+        m_headerWritten = true;
+        out += "timestamp,time,channel";
+        for (const QString &column : qAsConst(m_columns)) {
+            out += ',';
+            out += column;
+        }
+        out += '\n';
+    }
+    if (!m_atEnd) {
+        m_atEnd = !m_log->read(&m_cursor, m_fromMs, m_toMs, maxRecords, [&](const DeviceSample &sample) {
+            if (!matches(sample)) return;
+            if (m_format == Csv) {
+                appendCsv(sample, &out);
+            } else {
+                appendNdJson(sample, &out);
+            }
+            ++chunkRows;
+        });
+    }
+    m_rows += chunkRows;
+    if (rows) *rows = chunkRows;
+    return out;
+}
+
+double SampleExport::rowsPerSecond() const
+{
+    qint64 elapsed = m_timer.elapsed();
+    return elapsed > 0 ? m_rows * 1000.0 / elapsed : 0.0;
+}
+
+bool SampleExport::matches(const DeviceSample &sample) const
+{
+    if (m_channels.isEmpty()) return true;
+    return m_channels.contains(SampleHistory::channelName(sample.kind, sample.slaveId))
+            || m_channels.contains(DeviceSample::kindName(sample.kind));
+}
+
+void SampleExport::appendCsv(const DeviceSample &sample, QString *out) const
+{
+    const int kind = static_cast<int>(sample.kind);
+    if (kind < 1 || kind > 3) return;
+    const QVector<int> &columnOf = m_columnOf[kind];
+
+    QStringList cells;
+    for (int i = 0; i < m_columns.size(); ++i) cells.append(QString());
+    for (int field = 0; field < columnOf.size() && field < sample.valueCount; ++field) {
+        cells[columnOf.at(field)] = sample.formattedValue(field);
+    }
+    *out += QString::number(sample.timestampMs) + ','
+            + QDateTime::fromMSecsSinceEpoch(sample.timestampMs).toString("yyyy-MM-dd hh:mm:ss.zzz") + ','
+            + SampleHistory::channelName(sample.kind, sample.slaveId);
+    for (const QString &cell : qAsConst(cells)) {
+        *out += ',';
+        *out += cell;
+    }
+    *out += '\n';
+}
+
+void SampleExport::appendNdJson(const DeviceSample &sample, QString *out) const
+{
+    int count = 0;
+    const DeviceField *descriptors = DeviceSample::fields(sample.kind, &count);
+    QJsonObject values;
+    for (int field = 0; field < count && field < sample.valueCount; ++field) {
+        values[QString::fromLatin1(descriptors[field].key)] = sample.scaledValue(field);
+    }
+    QJsonObject row;
+    row["timestamp"] = static_cast<double>(sample.timestampMs);
+    row["channel"] = SampleHistory::channelName(sample.kind, sample.slaveId);
+    row["values"] = values;
+    *out += QString::fromUtf8(QJsonDocument(row).toJson(QJsonDocument::Compact));
+    *out += '\n';
+}
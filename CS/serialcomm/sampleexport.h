@@ -0,0 +1,56 @@
+#ifndef SAMPLEEXPORT_H
+#define SAMPLEEXPORT_H
+
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include "samplelog.h"
+
+// 把磁盘日志中的样本导出为 CSV 或 NDJSON 文本，逐块生成: 每块只读取一段记录，
+// 不把整段历史装进内存，几个月的数据也能边读边发。
+//
+// 过滤条件为时间范围和通道，通道可写 "microWater:1"(设备 + 从站)或 "microWater"(该设备全部从站)，
+// 为空表示全部。
+//   CSV: 首行为列名 timestamp,time,channel,字段…；字段列为所选设备字段的并集，不属于该设备的列留空
+//   NDJSON: 每行 {"timestamp":毫秒,"channel":"microWater:1","values":{"temperature":23.45,...}}
+// 数值按字段小数位换算为实际值。
+class SampleExport
+{
+public:
+    enum Format { Csv, NdJson };
+
+    SampleExport(SampleLog *log, Format format, qint64 fromMs, qint64 toMs,
+                 const QStringList &channels = QStringList());
+
+    static bool formatFromName(const QString &name, Format *format);
+    static QString formatName(Format format);
+
+    // 下一块文本(最多检查 maxRecords 条记录，可能为空)，读完后 atEnd() 为 true
+    QString nextChunk(int maxRecords, qint64 *rows = nullptr);
+    bool atEnd() const { return m_atEnd; }
+
+    qint64 rows() const { return m_rows; }
+    qint64 elapsedMs() const { return m_timer.elapsed(); }
+    double rowsPerSecond() const;
+
+private:
+    bool matches(const DeviceSample &sample) const;
+    void appendCsv(const DeviceSample &sample, QString *out) const;
+    void appendNdJson(const DeviceSample &sample, QString *out) const;
+
+    SampleLog *m_log;
+    Format m_format;
+    qint64 m_fromMs;
+    qint64 m_toMs;
+    QStringList m_channels;
+    SampleLog::Cursor m_cursor;
+    bool m_atEnd;
+    bool m_headerWritten;
+    qint64 m_rows;
+    QElapsedTimer m_timer;
+    // CSV: 字段列名，及各设备类型(按 DeviceKind 值)每个字段所在的列
+    QStringList m_columns;
+    QVector<int> m_columnOf[4];
+};
+
+#endif // SAMPLEEXPORT_H
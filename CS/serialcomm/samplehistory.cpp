@@ -0,0 +1,351 @@
+#include "samplehistory.h"
+#include <QJsonArray>
+#include <limits>
+#include <utility>
+
+namespace {
+const double kPowersOfTen[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0 };
+
+// 汇总粒度和保留的桶数
+const qint64 kRollupBucketMs[SampleHistory::RollupTiers] = { 60 * 1000, 15 * 60 * 1000, 3600 * 1000 };
+const int kRollupCapacity[SampleHistory::RollupTiers] = { 7 * 24 * 60, 31 * 24 * 4, 366 * 24 };
+}
+
+TimeRing::TimeRing(int capacity) :
+    m_head(0),
+    m_size(0),
+    m_timestamps(qMax(1, capacity))
+{
+}
+
+int TimeRing::push(qint64 timestampMs)
+{
+    int slot;
+    if (m_size < m_timestamps.size()) {
+        slot = physical(m_size);
+        ++m_size;
+    } else {
+        // 已满，覆盖最旧的
+        slot = m_head;
+        m_head = (m_head + 1) % m_timestamps.size();
+    }
+    m_timestamps[slot] = timestampMs;
+    return slot;
+}
+
+int TimeRing::lowerBound(qint64 timestampMs) const
+{
+    int low = 0;
+    int high = m_size;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (timestampAt(middle) < timestampMs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void TimeRing::range(qint64 fromMs, qint64 toMs, int *first, int *last) const
+{
+    *first = lowerBound(fromMs);
+    *last = toMs == std::numeric_limits<qint64>::max() ? m_size : lowerBound(toMs + 1);
+    if (*last < *first) *last = *first;
+}
+
+SampleRing::SampleRing(DeviceKind kind, quint8 slaveId, int capacity) :
+    TimeRing(capacity),
+    m_kind(kind),
+    m_slaveId(slaveId)
+{
+    DeviceSample::fields(kind, &m_valueCount);
+    for (int field = 0; field < m_valueCount; ++field) {
+        m_values[field].resize(this->capacity());
+    }
+}
+
+void SampleRing::append(const DeviceSample &sample)
+{
+    int slot = push(sample.timestampMs);
+    for (int field = 0; field < m_valueCount; ++field) {
+        m_values[field][slot] = field < sample.valueCount ? sample.values[field] : 0;
+    }
+}
+
+RollupRing::RollupRing(qint64 bucketMs, int valueCount, int capacity) :
+    TimeRing(capacity),
+    m_bucketMs(bucketMs),
+    m_valueCount(valueCount),
+    m_counts(this->capacity())
+{
+    for (int field = 0; field < m_valueCount; ++field) {
+        m_min[field].resize(this->capacity());
+        m_max[field].resize(this->capacity());
+        m_sum[field].resize(this->capacity());
+    }
+}
+
+void RollupRing::add(const DeviceSample &sample)
+{
+    qint64 start = sample.timestampMs - sample.timestampMs % m_bucketMs;
+    if (sample.timestampMs < 0 && start != sample.timestampMs) start -= m_bucketMs;
+
+    // 通常落在最新的桶或开一个新桶；各总线样本排队后可能略有倒序，落在较早的桶时找到它累加
+    int slot = -1;
+    if (size() > 0 && timestampAt(size() - 1) >= start) {
+        int i = lowerBound(start);
+        if (i == size() || timestampAt(i) != start) return; // 已被覆盖或无此桶，丢弃
+        slot = physical(i);
+    }
+
+    if (slot < 0) {
+        slot = push(start);
+        m_counts[slot] = 0;
+        for (int field = 0; field < m_valueCount; ++field) {
+            m_min[field][slot] = std::numeric_limits<qint64>::max();
+            m_max[field][slot] = std::numeric_limits<qint64>::min();
+            m_sum[field][slot] = 0;
+        }
+    }
+    ++m_counts[slot];
+    for (int field = 0; field < m_valueCount; ++field) {
+        qint64 value = field < sample.valueCount ? sample.values[field] : 0;
+        m_min[field][slot] = qMin(m_min[field][slot], value);
+        m_max[field][slot] = qMax(m_max[field][slot], value);
+        m_sum[field][slot] += value;
+    }
+}
+
+SampleHistory::SampleHistory(QObject *parent) :
+    QObject(parent),
+    m_capacity(DefaultCapacity)
+{
+}
+
+SampleHistory::~SampleHistory()
+{
+    clear();
+}
+
+void SampleHistory::setCapacity(int samplesPerChannel)
+{
+    m_capacity = qMax(1, samplesPerChannel);
+    clear();
+}
+
+void SampleHistory::clear()
+{
+    for (const Channel &channel : qAsConst(m_channels)) {
+        delete channel.samples;
+        for (RollupRing *rollup : channel.rollups) delete rollup;
+    }
+    m_channels.clear();
+}
+
+void SampleHistory::append(const DeviceSample &sample)
+{
+    QString name = channelName(sample.kind, sample.slaveId);
+    auto it = m_channels.find(name);
+    if (it == m_channels.end()) {
+        Channel channel;
+        channel.samples = new SampleRing(sample.kind, sample.slaveId, m_capacity);
+        for (int tier = 0; tier < RollupTiers; ++tier) {
+            channel.rollups[tier] = new RollupRing(kRollupBucketMs[tier], channel.samples->valueCount(),
+                                                   kRollupCapacity[tier]);
+        }
+        it = m_channels.insert(name, channel);
+    }
+    it.value().samples->append(sample);
+    for (RollupRing *rollup : it.value().rollups) rollup->add(sample);
+}
+
+void SampleHistory::swap(SampleHistory &other)
+{
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_channels, other.m_channels);
+}
+
+QStringList SampleHistory::channels() const
+{
+    QStringList names = m_channels.keys();
+    names.sort();
+    return names;
+}
+
+const SampleRing *SampleHistory::channel(const QString &name) const
+{
+    auto it = m_channels.constFind(name);
+    return it == m_channels.constEnd() ? nullptr : it.value().samples;
+}
+
+QString SampleHistory::channelName(DeviceKind kind, quint8 slaveId)
+{
+    return DeviceSample::kindName(kind) + ':' + QString::number(slaveId);
+}
+
+namespace {
+// 汇总桶 [first, last) 合并成的一个桶
+struct MergedBucket {
+    qint64 timestampMs = 0;
+    quint32 count = 0;
+    qint64 min[DeviceSample::MaxValues];
+    qint64 max[DeviceSample::MaxValues];
+    qint64 sum[DeviceSample::MaxValues];
+
+    double average(int field) const { return count > 0 ? double(sum[field]) / count : 0.0; }
+};
+
+MergedBucket mergeBuckets(const RollupRing *rollup, int first, int last, int valueCount)
+{
+    MergedBucket bucket;
+    bucket.timestampMs = rollup->timestampAt(first);
+    for (int field = 0; field < valueCount; ++field) {
+        bucket.min[field] = std::numeric_limits<qint64>::max();
+        bucket.max[field] = std::numeric_limits<qint64>::min();
+        bucket.sum[field] = 0;
+    }
+    for (int i = first; i < last; ++i) {
+        bucket.count += rollup->countAt(i);
+        for (int field = 0; field < valueCount; ++field) {
+            bucket.min[field] = qMin(bucket.min[field], rollup->minAt(i, field));
+            bucket.max[field] = qMax(bucket.max[field], rollup->maxAt(i, field));
+            bucket.sum[field] += rollup->sumAt(i, field);
+        }
+    }
+    return bucket;
+}
+}
+
+QJsonObject SampleHistory::query(const QString &channel, qint64 fromMs, qint64 toMs, int maxPoints,
+                                 const QStringList &fields) const
+{
+    QJsonObject result;
+    result["type"] = "HISTORY";
+    result["channel"] = channel;
+
+    const Selection selection = select(channel, fromMs, toMs, maxPoints);
+    result["resolution"] = selection.rollup ? static_cast<double>(selection.rollup->bucketMs() * selection.step) : 0.0;
+    result["total"] = selection.last - selection.first;
+
+    QJsonArray timestamps;
+    QJsonObject values;
+    QJsonObject minimums;
+    QJsonObject maximums;
+    if (selection.samples) {
+        int fieldCount = 0;
+        const DeviceField *descriptors = DeviceSample::fields(selection.samples->kind(), &fieldCount);
+        fieldCount = qMin(fieldCount, selection.samples->valueCount());
+        QVector<int> columns; // 要输出的字段
+        QVector<QJsonArray> valueColumns;
+        QVector<QJsonArray> minColumns;
+        QVector<QJsonArray> maxColumns;
+        for (int field = 0; field < fieldCount; ++field) {
+            if (fields.isEmpty() || fields.contains(QString::fromLatin1(descriptors[field].key))) columns.append(field);
+        }
+        valueColumns.resize(columns.size());
+        minColumns.resize(columns.size());
+        maxColumns.resize(columns.size());
+
+        QJsonArray counts;
+        for (int i = selection.first; i < selection.last; i += selection.step) {
+            if (selection.rollup) {
+                const MergedBucket bucket = mergeBuckets(selection.rollup, i, qMin(i + selection.step, selection.last),
+                                                         fieldCount);
+                timestamps.append(static_cast<double>(bucket.timestampMs));
+                counts.append(static_cast<double>(bucket.count));
+                for (int c = 0; c < columns.size(); ++c) {
+                    const double scale = kPowersOfTen[descriptors[columns[c]].decimals];
+                    valueColumns[c].append(bucket.average(columns[c]) / scale);
+                    minColumns[c].append(bucket.min[columns[c]] / scale);
+                    maxColumns[c].append(bucket.max[columns[c]] / scale);
+                }
+            } else {
+                timestamps.append(static_cast<double>(selection.samples->timestampAt(i)));
+                for (int c = 0; c < columns.size(); ++c) {
+                    const double scale = kPowersOfTen[descriptors[columns[c]].decimals];
+                    valueColumns[c].append(selection.samples->valueAt(i, columns[c]) / scale);
+                }
+            }
+        }
+        if (selection.rollup) result["count"] = counts;
+        for (int c = 0; c < columns.size(); ++c) {
+            const QString key = QString::fromLatin1(descriptors[columns[c]].key);
+            values[key] = valueColumns[c];
+            if (selection.rollup) {
+                minimums[key] = minColumns[c];
+                maximums[key] = maxColumns[c];
+            }
+        }
+    }
+    result["timestamps"] = timestamps;
+    result["values"] = values;
+    if (selection.rollup) {
+        result["min"] = minimums;
+        result["max"] = maximums;
+    }
+    return result;
+}
+
+QVector<DeviceSample> SampleHistory::samples(const QString &channel, qint64 fromMs, qint64 toMs, int maxPoints,
+                                             int *total, qint64 *resolution) const
+{
+    const Selection selection = select(channel, fromMs, toMs, maxPoints);
+    if (total) *total = selection.last - selection.first;
+    if (resolution) *resolution = selection.rollup ? selection.rollup->bucketMs() * selection.step : 0;
+
+    QVector<DeviceSample> result;
+    if (!selection.samples) return result;
+    result.reserve((selection.last - selection.first + selection.step - 1) / selection.step);
+    DeviceSample sample;
+    sample.kind = selection.samples->kind();
+    sample.slaveId = selection.samples->slaveId();
+    sample.valueCount = selection.samples->valueCount();
+    for (int i = selection.first; i < selection.last; i += selection.step) {
+        if (selection.rollup) {
+            const MergedBucket bucket = mergeBuckets(selection.rollup, i, qMin(i + selection.step, selection.last),
+                                                     sample.valueCount);
+            sample.timestampMs = bucket.timestampMs;
+            for (int field = 0; field < sample.valueCount; ++field) {
+                sample.values[field] = qRound64(bucket.average(field));
+            }
+        } else {
+            sample.timestampMs = selection.samples->timestampAt(i);
+            for (int field = 0; field < sample.valueCount; ++field) {
+                sample.values[field] = selection.samples->valueAt(i, field);
+            }
+        }
+        result.append(sample);
+    }
+    return result;
+}
+
+SampleHistory::Selection SampleHistory::select(const QString &channel, qint64 fromMs, qint64 toMs,
+                                               int maxPoints) const
+{
+    Selection selection;
+    auto it = m_channels.constFind(channel);
+    if (it == m_channels.constEnd()) return selection;
+    selection.samples = it.value().samples;
+
+    // 由细到粗，取第一个覆盖起点且点数不超过 maxPoints 的；范围只靠二分查找，不遍历
+    const TimeRing *ring = selection.samples;
+    ring->range(fromMs, toMs, &selection.first, &selection.last);
+    if (maxPoints > 0) {
+        bool fits = ring->covers(fromMs) && selection.last - selection.first <= maxPoints;
+        for (int tier = 0; tier < RollupTiers && !fits; ++tier) {
+            const RollupRing *rollup = it.value().rollups[tier];
+            // 起点所在的桶也算在内
+            rollup->range(fromMs - fromMs % rollup->bucketMs(), toMs, &selection.first, &selection.last);
+            selection.rollup = rollup;
+            ring = rollup;
+            fits = rollup->covers(fromMs) && selection.last - selection.first <= maxPoints;
+        }
+    }
+
+    // 原始样本等间隔抽取、汇总桶按步长合并，步长向上取整，保证不超过 maxPoints
+    int count = selection.last - selection.first;
+    if (maxPoints > 0 && count > maxPoints) selection.step = (count + maxPoints - 1) / maxPoints;
+    return selection;
+}
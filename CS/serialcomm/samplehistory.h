@@ -0,0 +1,149 @@
+#ifndef SAMPLEHISTORY_H
+#define SAMPLEHISTORY_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QJsonObject>
+#include "devicesample.h"
+
+// 定长环形时间轴: 容量在构造时一次分配，满后覆盖最旧的。
+// 时间按到达顺序追加，单调不减时可按时间二分查找。
+class TimeRing
+{
+public:
+    explicit TimeRing(int capacity);
+
+    int capacity() const { return m_timestamps.size(); }
+    int size() const { return m_size; }
+    // 第 i 个(0 为最旧)条目的时间
+    qint64 timestampAt(int i) const { return m_timestamps.at(physical(i)); }
+    // [from, to] 内条目的下标范围 [*first, *last)
+    void range(qint64 fromMs, qint64 toMs, int *first, int *last) const;
+    // 未覆盖过数据，或最旧的条目不晚于 fromMs
+    bool covers(qint64 fromMs) const { return m_size < capacity() || timestampAt(0) <= fromMs; }
+
+protected:
+    // 追加一个时间，返回其物理位置
+    int push(qint64 timestampMs);
+    int physical(int i) const { return (m_head + i) % m_timestamps.size(); }
+    int lowerBound(qint64 timestampMs) const;
+
+private:
+    int m_head; // 最旧条目的位置
+    int m_size;
+    QVector<qint64> m_timestamps;
+};
+
+// 单个通道(设备 + 从站)的原始样本，按列存储(每个字段一列)
+class SampleRing : public TimeRing
+{
+public:
+    SampleRing(DeviceKind kind, quint8 slaveId, int capacity);
+
+    DeviceKind kind() const { return m_kind; }
+    quint8 slaveId() const { return m_slaveId; }
+    int valueCount() const { return m_valueCount; }
+
+    void append(const DeviceSample &sample);
+    qint64 valueAt(int i, int field) const { return m_values[field].at(physical(i)); }
+
+private:
+    DeviceKind m_kind;
+    quint8 m_slaveId;
+    int m_valueCount;
+    QVector<qint64> m_values[DeviceSample::MaxValues];
+};
+
+// 单个通道一个粒度的汇总: 每个时间桶(起始时刻对齐到 bucketMs 的整数倍)的条数和各字段最小/最大/总和，
+// 样本到达时就地累加到所属的桶
+class RollupRing : public TimeRing
+{
+public:
+    RollupRing(qint64 bucketMs, int valueCount, int capacity);
+
+    qint64 bucketMs() const { return m_bucketMs; }
+    void add(const DeviceSample &sample);
+    quint32 countAt(int i) const { return m_counts.at(physical(i)); }
+    qint64 minAt(int i, int field) const { return m_min[field].at(physical(i)); }
+    qint64 maxAt(int i, int field) const { return m_max[field].at(physical(i)); }
+    qint64 sumAt(int i, int field) const { return m_sum[field].at(physical(i)); }
+    double averageAt(int i, int field) const { return double(m_sum[field].at(physical(i))) / countAt(i); }
+
+private:
+    qint64 m_bucketMs;
+    int m_valueCount;
+    QVector<quint32> m_counts;
+    QVector<qint64> m_min[DeviceSample::MaxValues];
+    QVector<qint64> m_max[DeviceSample::MaxValues];
+    QVector<qint64> m_sum[DeviceSample::MaxValues];
+};
+
+// 各通道最近样本的内存存储，供前端查询趋势，查询不访问总线。
+// 通道名为 "设备:从站"，如 "microWater:1"。只在界面线程中使用。
+//
+// 除原始样本外，每个通道按 1 分钟(保留 7 天)、15 分钟(31 天)、1 小时(366 天)三级汇总，
+// 样本到达时增量更新，不重新扫描原始数据。查询时依次看原始样本和各级汇总，
+// 取第一个覆盖查询起点且点数不超过 maxPoints 的(即满足点数限制的最细粒度)，都超过时把最粗一级的相邻桶合并，
+// 宽时间范围的查询耗时与返回的点数成正比，与原始样本数无关。
+class SampleHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { DefaultCapacity = 17280 }; // 每通道原始样本条数，5 秒一条约一天
+    enum { RollupTiers = 3 };
+
+    explicit SampleHistory(QObject *parent = nullptr);
+    ~SampleHistory();
+
+    // 修改容量会清空已有数据
+    void setCapacity(int samplesPerChannel);
+    int capacity() const { return m_capacity; }
+
+    void append(const DeviceSample &sample);
+    // 与 other 交换全部数据和容量(如换入后台回放好的历史)
+    void swap(SampleHistory &other);
+    QStringList channels() const;
+    const SampleRing *channel(const QString &name) const;
+    static QString channelName(DeviceKind kind, quint8 slaveId);
+
+    // 时间范围内的数据，按列返回:
+    //   {"type":"HISTORY","channel":..,"resolution":0,"timestamps":[..],"values":{"字段":[..]}}
+    // resolution 为 0 时是原始样本，超过 maxPoints 条时等间隔抽取，保留原始值；
+    // 否则为汇总桶的毫秒宽度，timestamps 为桶起始时刻，values 为平均值，另附 min、max 和每桶条数 count。
+    // 最粗一级仍超过 maxPoints 时每 step 个相邻桶合并为一个(min 取最小、max 取最大、总和与条数相加)，
+    // resolution 为合并后的宽度。
+    // fields 为空表示全部字段
+    QJsonObject query(const QString &channel, qint64 fromMs, qint64 toMs, int maxPoints,
+                      const QStringList &fields = QStringList()) const;
+    // 与 query() 相同的选择，返回样本本身(汇总时为取整的平均值)；
+    // *total 为所选分辨率下抽取前的条数，*resolution 同 query()
+    QVector<DeviceSample> samples(const QString &channel, qint64 fromMs, qint64 toMs, int maxPoints,
+                                  int *total = nullptr, qint64 *resolution = nullptr) const;
+
+private:
+    struct Channel {
+        SampleRing *samples;
+        RollupRing *rollups[RollupTiers];
+    };
+
+    // 查询所用的数据: rollup 为空时用原始样本，下标范围 [first, last)，
+    // 原始样本每 step 条取一条，汇总桶每 step 个合并为一个
+    struct Selection {
+        const SampleRing *samples = nullptr;
+        const RollupRing *rollup = nullptr;
+        int first = 0;
+        int last = 0;
+        int step = 1;
+    };
+
+    Selection select(const QString &channel, qint64 fromMs, qint64 toMs, int maxPoints) const;
+    void clear();
+
+    int m_capacity;
+    QHash<QString, Channel> m_channels;
+};
+
+#endif // SAMPLEHISTORY_H
@@ -0,0 +1,836 @@
+#include "samplelog.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+#include <QDateTime>
+#include <QtEndian>
+#include <QThread>
+#include <QHash>
+#include <QVector>
+#include <cstring>
+#include "modbuscrc.h"
+#include "sampleblockcodec.h"
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+namespace {
+const char kMagic[4] = { 'S', 'M', 'P', 'L' };
+const char *const kSource = "storage";
+const qint64 kDefaultSegmentBytes = 16 * 1024 * 1024;
+const int kDefaultSyncIntervalMs = 1000;
+const int kCrcOffset = 88;
+// 各总线的样本排队到界面线程后才写入，相邻记录的时间可能略有倒序，定位起点时向前多留这么多
+const qint64 kReorderSlackMs = 2000;
+
+const char *const kSealSuffix = ".tmp"; // 封存中的临时文件: 00000001.seg.tmp
+const int kSealChunkRecords = 4096;
+const int kChunkHeaderSize = 32;
+const int kMaxChunkGroups = 255;
+const quint8 kInvalidRecord = 0xFF;
+
+bool syncFile(QFile *file)
+{
+    if (!file->flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file->handle()) == 0;
+#else
+    return fsync(file->handle()) == 0;
+#endif
+}
+
+// 用 from 原子地替换 to: 读取方要么打开旧文件，要么打开新文件，不会看到 to 不存在
+bool replaceFile(const QString &from, const QString &to)
+{
+#ifdef Q_OS_WIN
+    return MoveFileExW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(from).utf16()),
+                       reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(to).utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return ::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
+
+struct ChunkHeader {
+    quint32 payloadSize = 0;
+    quint32 records = 0;
+    qint64 firstMs = -1;
+    qint64 lastMs = -1;
+    quint16 crc = 0;
+    quint16 groups = 0;
+};
+
+// 读取 p 处的块头，块超出 end 时返回 false
+bool readChunkHeader(const uchar *p, const uchar *end, ChunkHeader *header)
+{
+    if (end - p < kChunkHeaderSize) return false;
+    header->payloadSize = qFromLittleEndian<quint32>(p);
+    header->records = qFromLittleEndian<quint32>(p + 4);
+    header->firstMs = qFromLittleEndian<qint64>(p + 8);
+    header->lastMs = qFromLittleEndian<qint64>(p + 16);
+    header->crc = qFromLittleEndian<quint16>(p + 24);
+    header->groups = qFromLittleEndian<quint16>(p + 26);
+    return header->records <= header->payloadSize && end - p - kChunkHeaderSize >= qint64(header->payloadSize);
+}
+
+// 封存分段的一块: 按通道和字段数分组，组内用 SampleBlockCodec 编码
+class ChunkBuilder
+{
+public:
+    int size() const { return m_order.size(); }
+
+    // sample 为空表示 CRC 错误的记录，只占位置；组数已满放不下时返回 false
+    bool add(const DeviceSample *sample)
+    {
+        if (!sample) {
+            m_order.append(char(kInvalidRecord));
+            return true;
+        }
+        const quint32 key = (quint32(sample->kind) << 16) | (quint32(sample->slaveId) << 8) | quint8(sample->valueCount);
+        auto it = m_groupIndex.constFind(key);
+        if (it == m_groupIndex.constEnd()) {
+            if (m_groups.size() >= kMaxChunkGroups) return false;
+            it = m_groupIndex.insert(key, m_groups.size());
+            m_groups.append(QVector<DeviceSample>());
+        }
+        m_order.append(char(it.value()));
+        m_groups[it.value()].append(*sample);
+        if (m_firstMs < 0) m_firstMs = sample->timestampMs;
+        m_lastMs = sample->timestampMs;
+        return true;
+    }
+
+    // 块头 + 数据，之后清空
+    QByteArray take()
+    {
+        QByteArray payload = m_order;
+        uchar length[4];
+        for (const QVector<DeviceSample> &group : qAsConst(m_groups)) {
+            QByteArray block = SampleBlockCodec::encode(group);
+            qToLittleEndian<quint32>(quint32(block.size()), length);
+            payload.append(reinterpret_cast<const char *>(length), 4);
+            payload.append(block);
+        }
+
+        uchar header[kChunkHeaderSize] = {};
+        qToLittleEndian<quint32>(quint32(payload.size()), header);
+        qToLittleEndian<quint32>(quint32(m_order.size()), header + 4);
+        qToLittleEndian<qint64>(m_firstMs, header + 8);
+        qToLittleEndian<qint64>(m_lastMs, header + 16);
+        qToLittleEndian<quint16>(ModbusCrc::calculate(payload.constData(), payload.size()), header + 24);
+        qToLittleEndian<quint16>(quint16(m_groups.size()), header + 26);
+        QByteArray chunk(reinterpret_cast<const char *>(header), kChunkHeaderSize);
+        chunk.append(payload);
+
+        m_order.clear();
+        m_groups.clear();
+        m_groupIndex.clear();
+        m_firstMs = -1;
+        m_lastMs = -1;
+        return chunk;
+    }
+
+private:
+    QByteArray m_order; // 每条记录所属的组
+    QVector<QVector<DeviceSample>> m_groups;
+    QHash<quint32, int> m_groupIndex;
+    qint64 m_firstMs = -1;
+    qint64 m_lastMs = -1;
+};
+
+// 按写入顺序还原一块中的记录，valid 标记原记录是否有效；CRC 或格式错误时返回 false
+bool decodeChunk(const ChunkHeader &header, const uchar *payload, QVector<DeviceSample> *samples,
+                 QVector<bool> *valid)
+{
+    if (ModbusCrc::calculate(reinterpret_cast<const char *>(payload), int(header.payloadSize)) != header.crc) {
+        return false;
+    }
+    const uchar *p = payload + header.records;
+    const uchar *end = payload + header.payloadSize;
+    QVector<QVector<DeviceSample>> groups(header.groups);
+    for (QVector<DeviceSample> &group : groups) {
+        if (end - p < 4) return false;
+        const quint32 length = qFromLittleEndian<quint32>(p);
+        p += 4;
+        if (quint64(end - p) < length) return false;
+        if (!SampleBlockCodec::decode(QByteArray::fromRawData(reinterpret_cast<const char *>(p), int(length)), &group)) {
+            return false;
+        }
+        p += length;
+    }
+
+    samples->resize(int(header.records));
+    valid->fill(false, int(header.records));
+    QVector<int> next(groups.size(), 0);
+    for (int i = 0; i < int(header.records); ++i) {
+        const quint8 index = payload[i];
+        if (index == kInvalidRecord) continue;
+        if (index >= groups.size() || next[index] >= groups[index].size()) return false;
+        (*samples)[i] = groups[index][next[index]++];
+        (*valid)[i] = true;
+    }
+    return true;
+}
+
+// 在后台封存一个分段
+class SealThread : public QThread
+{
+public:
+    SealThread(const QString &source, qint64 records, const QString &target, QObject *parent) :
+        QThread(parent), m_source(source), m_target(target), m_records(records) {}
+
+    bool succeeded() const { return m_succeeded; }
+    qint64 bytes() const { return m_bytes; }
+    QString errorString() const { return m_errorString; }
+    QString target() const { return m_target; }
+
+protected:
+    void run() override
+    {
+        m_succeeded = SampleLog::sealSegment(m_source, m_records, m_target,
+                                             [this] { return isInterruptionRequested(); },
+                                             &m_bytes, &m_errorString);
+    }
+
+private:
+    QString m_source;
+    QString m_target;
+    qint64 m_records;
+    bool m_succeeded = false;
+    qint64 m_bytes = 0;
+    QString m_errorString;
+};
+}
+
+SampleLog::SampleLog(QObject *parent) :
+    QObject(parent),
+    m_active(nullptr),
+    m_syncTimer(new QTimer(this)),
+    m_dirty(false),
+    m_segmentSize(kDefaultSegmentBytes),
+    m_maxBytes(0),
+    m_maxAgeMs(0),
+    m_sealer(nullptr),
+    m_sealing(0)
+{
+    m_syncTimer->setInterval(kDefaultSyncIntervalMs);
+    connect(m_syncTimer, &QTimer::timeout, this, [this]() {
+        if (m_dirty) sync();
+    });
+}
+
+SampleLog::~SampleLog()
+{
+    close();
+}
+
+bool SampleLog::open(const QString &directory, QString *errorString)
+{
+    close();
+    QDir dir(directory);
+    if (!dir.mkpath(".")) {
+        if (errorString) *errorString = QString("无法创建数据目录 %1").arg(directory);
+        return false;
+    }
+    m_directory = dir.absolutePath();
+
+    // 封存中断留下的临时文件可能不完整，原文件仍在，直接删除
+    const QStringList sealing = dir.entryList(QStringList() << QString("*.seg") + kSealSuffix, QDir::Files);
+    for (const QString &name : sealing) {
+        QFile::remove(dir.filePath(name));
+    }
+
+    quint32 lastSequence = 0;
+    const QStringList names = dir.entryList(QStringList() << "*.seg", QDir::Files, QDir::Name);
+    for (const QString &name : names) {
+        bool ok = false;
+        Segment segment;
+        segment.sequence = QFileInfo(name).baseName().toUInt(&ok);
+        if (!ok) continue;
+        segment.path = dir.filePath(name);
+        m_segments.append(segment);
+        lastSequence = qMax(lastSequence, segment.sequence);
+    }
+
+    // 只有最后一段可能被中断写入
+    for (int i = 0; i < m_segments.size(); ++i) {
+        QString error;
+        if (!scanSegment(&m_segments[i], i == m_segments.size() - 1, &error)) {
+            log(LogLevel::Warning, error);
+            m_segments.removeAt(i--);
+        }
+    }
+
+    QString error;
+    // 最后一段未写满时续写，否则(包括最后一段文件头损坏被跳过)新开一段
+    bool reuse = !m_segments.isEmpty() && m_segments.last().sequence == lastSequence
+            && m_segments.last().version == Version && QFileInfo(m_segments.last().path).size() < m_segmentSize;
+    quint32 sequence = reuse ? lastSequence : lastSequence + 1;
+    if (reuse) m_segments.removeLast(); // openActive 重新加入
+    if (!openActive(sequence, &error)) {
+        if (errorString) *errorString = error;
+        m_segments.clear();
+        return false;
+    }
+    applyRetention();
+    m_syncTimer->start();
+    // 上次未来得及封存的分段(及旧版本留下的)在后台补上
+    for (int i = 0; i + 1 < m_segments.size(); ++i) {
+        if (m_segments.at(i).version == Version) m_sealQueue.append(m_segments.at(i).sequence);
+    }
+    scheduleSeal();
+    log(LogLevel::Info, QString("样本日志 %1: %2 段, %3 条记录")
+        .arg(m_directory).arg(m_segments.size()).arg(recordCount()));
+    return true;
+}
+
+void SampleLog::close()
+{
+    if (!m_active) return;
+    stopSeal();
+    m_syncTimer->stop();
+    sync();
+    delete m_active;
+    m_active = nullptr;
+    m_segments.clear();
+}
+
+void SampleLog::setSegmentSize(qint64 bytes)
+{
+    m_segmentSize = qMax<qint64>(bytes, HeaderSize + RecordSize);
+}
+
+void SampleLog::setRetention(qint64 maxBytes, int maxAgeDays)
+{
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    m_maxAgeMs = qMax(0, maxAgeDays) * qint64(24 * 3600 * 1000);
+    if (isOpen()) applyRetention();
+}
+
+void SampleLog::setSyncInterval(int ms)
+{
+    m_syncTimer->setInterval(qMax(1, ms));
+}
+
+void SampleLog::append(const DeviceSample &sample)
+{
+    if (!m_active) return;
+    uchar record[RecordSize];
+    encodeRecord(sample, record);
+    if (m_active->write(reinterpret_cast<const char *>(record), RecordSize) != RecordSize) {
+        log(LogLevel::Error, "写入样本日志失败: " + m_active->errorString());
+        return;
+    }
+    m_dirty = true;
+
+    Segment &segment = m_segments.last();
+    if (segment.records++ == 0) segment.firstMs = sample.timestampMs;
+    segment.lastMs = sample.timestampMs;
+    segment.bytes += RecordSize;
+    if (HeaderSize + segment.records * RecordSize >= m_segmentSize) rotate();
+}
+
+void SampleLog::sync()
+{
+    if (!m_active) return;
+    if (!syncFile(m_active)) log(LogLevel::Error, "样本日志同步失败: " + m_active->errorString());
+    m_dirty = false;
+}
+
+qint64 SampleLog::replay(qint64 fromMs, qint64 toMs, const std::function<void(const DeviceSample &)> &visitor)
+{
+    qint64 count = 0;
+    Cursor cursor;
+    while (read(&cursor, fromMs, toMs, 64 * 1024, [&](const DeviceSample &sample) {
+        visitor(sample);
+        ++count;
+    })) {
+    }
+    return count;
+}
+
+bool SampleLog::read(Cursor *cursor, qint64 fromMs, qint64 toMs, int maxRecords,
+                     const std::function<void(const DeviceSample &)> &visitor)
+{
+    if (m_active) m_active->flush(); // 让映射看到缓冲中的记录
+    return readSegments(m_segments, cursor, fromMs, toMs, maxRecords, visitor);
+}
+
+SampleLog::Snapshot SampleLog::snapshot()
+{
+    if (m_active) m_active->flush();
+    Snapshot snapshot;
+    snapshot.m_segments = m_segments;
+    return snapshot;
+}
+
+bool SampleLog::Snapshot::read(Cursor *cursor, qint64 fromMs, qint64 toMs, int maxRecords,
+                               const std::function<void(const DeviceSample &)> &visitor) const
+{
+    return readSegments(m_segments, cursor, fromMs, toMs, maxRecords, visitor);
+}
+
+qint64 SampleLog::Snapshot::recordCount() const
+{
+    qint64 records = 0;
+    for (const Segment &segment : m_segments) records += segment.records;
+    return records;
+}
+
+bool SampleLog::readSegments(const QList<Segment> &segments, Cursor *cursor, qint64 fromMs, qint64 toMs,
+                             int maxRecords, const std::function<void(const DeviceSample &)> &visitor)
+{
+    for (const Segment &segment : segments) {
+        // 读取期间旧分段可能已按保存期限删除，从下一个仍存在的分段继续
+        if (segment.sequence < cursor->sequence) continue;
+        if (segment.sequence > cursor->sequence) {
+            cursor->sequence = segment.sequence;
+            cursor->record = -1;
+        }
+        if (segment.records == 0 || segment.lastMs + kReorderSlackMs < fromMs
+                || cursor->record >= segment.records) {
+            ++cursor->sequence;
+            cursor->record = -1;
+            continue;
+        }
+        if (segment.firstMs - kReorderSlackMs > toMs) return false; // 之后的分段更晚
+
+        // 快照中的分段可能已在后台封存，格式以文件头为准
+        QFile file(segment.path);
+        const qint64 size = file.open(QIODevice::ReadOnly) ? file.size() : 0;
+        uchar *data = size >= HeaderSize ? file.map(0, size) : nullptr;
+        if (!data) {
+            LogBuffer::instance()->append(LogLevel::Warning, kSource,
+                                          QString("无法读取样本日志 %1: %2").arg(segment.path, file.errorString()));
+            ++cursor->sequence;
+            cursor->record = -1;
+            continue;
+        }
+
+        bool finished = false;
+        DeviceSample sample;
+        auto visit = [&](const DeviceSample &record) {
+            if (record.timestampMs > toMs + kReorderSlackMs) {
+                finished = true;
+                return false;
+            }
+            if (record.timestampMs >= fromMs && record.timestampMs <= toMs) visitor(record);
+            return true;
+        };
+
+        if (qFromLittleEndian<quint16>(data + 4) == SealedVersion) {
+            // 找到 cursor 所在的块(未定位时为第一个可能含 fromMs 的块)，解码后逐条回放
+            const uchar *p = data + HeaderSize;
+            const uchar *end = data + size;
+            qint64 first = 0;
+            ChunkHeader header;
+            bool located = false;
+            while (!located && readChunkHeader(p, end, &header)) {
+                if (cursor->record < 0 && (header.lastMs < 0 || header.lastMs + kReorderSlackMs >= fromMs)) {
+                    cursor->record = first;
+                }
+                located = cursor->record >= first && cursor->record < first + header.records;
+                if (!located) {
+                    first += header.records;
+                    p += kChunkHeaderSize + header.payloadSize;
+                }
+            }
+            if (!located) {
+                cursor->record = segment.records; // 本段已读完
+            } else {
+                QVector<DeviceSample> samples;
+                QVector<bool> valid;
+                if (!decodeChunk(header, p + kChunkHeaderSize, &samples, &valid)) {
+                    LogBuffer::instance()->append(LogLevel::Warning, kSource,
+                                                  QString("样本日志 %1 第 %2 条起的一块已损坏，跳过")
+                                                  .arg(segment.path).arg(first));
+                    cursor->record = first + header.records;
+                } else {
+                    const qint64 last = qMin(first + header.records, cursor->record + qMax(1, maxRecords));
+                    for (; cursor->record < last; ++cursor->record) {
+                        if (valid.at(int(cursor->record - first)) && !visit(samples.at(int(cursor->record - first)))) break;
+                    }
+                }
+            }
+        } else {
+            const uchar *records = data + HeaderSize;
+            const qint64 count = qMin(segment.records, (size - HeaderSize) / RecordSize);
+            if (cursor->record < 0) {
+                // 二分查找第一条不早于 fromMs - kReorderSlackMs 的记录
+                qint64 low = 0;
+                qint64 high = count;
+                while (low < high) {
+                    qint64 middle = (low + high) / 2;
+                    if (qFromLittleEndian<qint64>(records + middle * RecordSize + 8) < fromMs - kReorderSlackMs) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+                cursor->record = low;
+            }
+            const qint64 last = qMin(count, cursor->record + qMax(1, maxRecords));
+            for (; cursor->record < last; ++cursor->record) {
+                if (decodeRecord(records + cursor->record * RecordSize, &sample) && !visit(sample)) break;
+            }
+            if (count < segment.records && cursor->record >= count) cursor->record = segment.records;
+        }
+        file.unmap(data);
+        return !finished;
+    }
+    return false;
+}
+
+qint64 SampleLog::totalBytes() const
+{
+    qint64 bytes = 0;
+    for (const Segment &segment : m_segments) bytes += segment.bytes;
+    return bytes;
+}
+
+qint64 SampleLog::recordCount() const
+{
+    qint64 records = 0;
+    for (const Segment &segment : m_segments) records += segment.records;
+    return records;
+}
+
+void SampleLog::encodeRecord(const DeviceSample &sample, uchar *record)
+{
+    memset(record, 0, RecordSize);
+    int count = qBound(0, sample.valueCount, int(DeviceSample::MaxValues));
+    record[0] = static_cast<uchar>(sample.kind);
+    record[1] = sample.slaveId;
+    record[2] = static_cast<uchar>(count);
+    qToLittleEndian<qint64>(sample.timestampMs, record + 8);
+    qToLittleEndian<qint64>(sample.deviceTime, record + 16);
+    for (int i = 0; i < count; ++i) {
+        qToLittleEndian<qint64>(sample.values[i], record + 24 + i * 8);
+    }
+    qToLittleEndian<quint16>(ModbusCrc::calculate(reinterpret_cast<const char *>(record), kCrcOffset),
+                             record + kCrcOffset);
+}
+
+bool SampleLog::decodeRecord(const uchar *record, DeviceSample *sample)
+{
+    if (ModbusCrc::calculate(reinterpret_cast<const char *>(record), kCrcOffset)
+            != qFromLittleEndian<quint16>(record + kCrcOffset)) {
+        return false;
+    }
+    sample->kind = static_cast<DeviceKind>(record[0]);
+    sample->slaveId = record[1];
+    sample->valueCount = qMin<int>(record[2], DeviceSample::MaxValues);
+    sample->timestampMs = qFromLittleEndian<qint64>(record + 8);
+    sample->deviceTime = qFromLittleEndian<qint64>(record + 16);
+    for (int i = 0; i < DeviceSample::MaxValues; ++i) {
+        sample->values[i] = i < sample->valueCount ? qFromLittleEndian<qint64>(record + 24 + i * 8) : 0;
+    }
+    return true;
+}
+
+bool SampleLog::scanSegment(Segment *segment, bool repair, QString *errorString) const
+{
+    segment->records = 0;
+    segment->firstMs = -1;
+    segment->lastMs = -1;
+    segment->version = Version;
+    segment->bytes = 0;
+
+    QFile file(segment->path);
+    if (!file.open(repair ? QIODevice::ReadWrite : QIODevice::ReadOnly)) {
+        *errorString = QString("无法打开样本日志 %1: %2").arg(segment->path, file.errorString());
+        return false;
+    }
+    const qint64 size = file.size();
+    QByteArray header = file.read(HeaderSize);
+    if (header.size() != HeaderSize || memcmp(header.constData(), kMagic, sizeof(kMagic)) != 0
+            || qFromLittleEndian<quint16>(header.constData() + 6) != RecordSize) {
+        *errorString = QString("样本日志 %1 文件头无效，已跳过").arg(segment->path);
+        return false;
+    }
+    const quint16 version = qFromLittleEndian<quint16>(header.constData() + 4);
+    if (version == SealedVersion) {
+        // 封存分段只读块头: 条数累加，首尾时间取自首尾两块
+        uchar *data = file.map(0, size);
+        if (!data) {
+            *errorString = QString("无法映射样本日志 %1: %2").arg(segment->path, file.errorString());
+            return false;
+        }
+        const uchar *p = data + HeaderSize;
+        const uchar *end = data + size;
+        ChunkHeader chunk;
+        while (readChunkHeader(p, end, &chunk)) {
+            if (segment->firstMs < 0) segment->firstMs = chunk.firstMs;
+            if (chunk.lastMs >= 0) segment->lastMs = chunk.lastMs;
+            segment->records += chunk.records;
+            p += kChunkHeaderSize + chunk.payloadSize;
+        }
+        if (p != end) {
+            log(LogLevel::Warning, QString("样本日志 %1 末尾有 %2 字节无法解析，已忽略")
+                .arg(segment->path).arg(end - p));
+        }
+        segment->bytes = p - data;
+        file.unmap(data);
+        segment->version = SealedVersion;
+        return true;
+    }
+    if (version != Version) {
+        *errorString = QString("样本日志 %1 的格式版本 %2 不受支持，已跳过").arg(segment->path).arg(version);
+        return false;
+    }
+
+    qint64 records = (size - HeaderSize) / RecordSize;
+    if (records > 0) {
+        uchar *data = file.map(0, HeaderSize + records * RecordSize);
+        if (!data) {
+            *errorString = QString("无法映射样本日志 %1: %2").arg(segment->path, file.errorString());
+            return false;
+        }
+        DeviceSample sample;
+        if (repair) {
+            // 从尾部向前找到最后一条完整记录
+            while (records > 0 && !decodeRecord(data + HeaderSize + (records - 1) * RecordSize, &sample)) {
+                --records;
+            }
+        }
+        if (records > 0) {
+            decodeRecord(data + HeaderSize, &sample);
+            segment->firstMs = sample.timestampMs;
+            decodeRecord(data + HeaderSize + (records - 1) * RecordSize, &sample);
+            segment->lastMs = sample.timestampMs;
+        }
+        file.unmap(data);
+    }
+
+    const qint64 validSize = HeaderSize + records * RecordSize;
+    if (repair && validSize < size) {
+        if (!file.resize(validSize)) {
+            *errorString = QString("无法截断样本日志 %1: %2").arg(segment->path, file.errorString());
+            return false;
+        }
+        log(LogLevel::Warning, QString("样本日志 %1 末尾有 %2 字节不完整，已截断")
+            .arg(segment->path).arg(size - validSize));
+    }
+    segment->records = records;
+    segment->bytes = validSize;
+    return true;
+}
+
+bool SampleLog::openActive(quint32 sequence, QString *errorString)
+{
+    Segment segment;
+    segment.sequence = sequence;
+    segment.path = segmentPath(sequence);
+    segment.records = 0;
+    segment.firstMs = -1;
+    segment.lastMs = -1;
+    segment.version = Version;
+    segment.bytes = HeaderSize;
+
+    QFile *file = new QFile(segment.path);
+    if (!file->open(QIODevice::ReadWrite)) {
+        if (errorString) *errorString = QString("无法打开样本日志 %1: %2").arg(segment.path, file->errorString());
+        delete file;
+        return false;
+    }
+    if (file->size() == 0) {
+        uchar header[HeaderSize] = {};
+        memcpy(header, kMagic, sizeof(kMagic));
+        qToLittleEndian<quint16>(Version, header + 4);
+        qToLittleEndian<quint16>(RecordSize, header + 6);
+        qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 8);
+        file->write(reinterpret_cast<const char *>(header), HeaderSize);
+    } else {
+        // 续写上次未写满的分段，open() 已校验并截断
+        QString error;
+        if (!scanSegment(&segment, false, &error)) {
+            if (errorString) *errorString = error;
+            delete file;
+            return false;
+        }
+    }
+    if (!file->seek(file->size())) {
+        if (errorString) *errorString = QString("无法定位样本日志 %1: %2").arg(segment.path, file->errorString());
+        delete file;
+        return false;
+    }
+
+    delete m_active;
+    m_active = file;
+    m_segments.append(segment);
+    return true;
+}
+
+void SampleLog::rotate()
+{
+    sync();
+    QString error;
+    const quint32 closed = m_segments.last().sequence;
+    if (!openActive(closed + 1, &error)) {
+        // 新分段打不开时继续写当前分段
+        log(LogLevel::Error, error);
+        return;
+    }
+    applyRetention();
+    m_sealQueue.append(m_sealRetry);
+    m_sealRetry.clear();
+    m_sealQueue.append(closed);
+    scheduleSeal();
+}
+
+void SampleLog::scheduleSeal()
+{
+    if (m_sealer || !m_active) return;
+    while (!m_sealQueue.isEmpty()) {
+        const quint32 sequence = m_sealQueue.takeFirst();
+        const int index = indexOfSegment(sequence);
+        // 已删除、已封存的分段和活动分段跳过
+        if (index < 0 || index == m_segments.size() - 1 || m_segments.at(index).version != Version) continue;
+        const Segment &segment = m_segments.at(index);
+        SealThread *thread = new SealThread(segment.path, segment.records, segment.path + kSealSuffix, this);
+        connect(thread, &QThread::finished, this, &SampleLog::finishSeal);
+        m_sealer = thread;
+        m_sealing = sequence;
+        thread->start(QThread::LowPriority);
+        return;
+    }
+}
+
+void SampleLog::finishSeal()
+{
+    SealThread *thread = static_cast<SealThread *>(m_sealer);
+    if (!thread || sender() != thread) return; // close() 已中断并销毁
+    m_sealer = nullptr;
+    thread->deleteLater();
+
+    const int index = indexOfSegment(m_sealing);
+    if (!thread->succeeded()) {
+        log(LogLevel::Warning, "封存样本日志失败: " + thread->errorString());
+        QFile::remove(thread->target());
+    } else if (index < 0) {
+        QFile::remove(thread->target()); // 封存期间已按保存期限删除
+    } else {
+        // 临时文件已 fsync，原子替换原文件
+        Segment &segment = m_segments[index];
+        if (!replaceFile(thread->target(), segment.path)) {
+            // 原文件正被读取(Windows 下映射中的文件不能替换)，下次轮换时再试
+            log(LogLevel::Warning, "无法替换样本日志 " + segment.path + "，下次轮换时重新封存");
+            QFile::remove(thread->target());
+            m_sealRetry.append(m_sealing);
+        } else {
+            log(LogLevel::Info, QString("样本日志 %1 已封存: %2 条记录 %3 KB -> %4 KB")
+                .arg(segment.path).arg(segment.records)
+                .arg(segment.bytes / 1024).arg(thread->bytes() / 1024));
+            segment.version = SealedVersion;
+            segment.bytes = thread->bytes();
+        }
+    }
+    scheduleSeal();
+}
+
+void SampleLog::stopSeal()
+{
+    m_sealQueue.clear();
+    m_sealRetry.clear();
+    if (!m_sealer) return;
+    SealThread *thread = static_cast<SealThread *>(m_sealer);
+    m_sealer = nullptr;
+    thread->requestInterruption();
+    thread->wait();
+    QFile::remove(thread->target());
+    delete thread;
+}
+
+int SampleLog::indexOfSegment(quint32 sequence) const
+{
+    for (int i = 0; i < m_segments.size(); ++i) {
+        if (m_segments.at(i).sequence == sequence) return i;
+    }
+    return -1;
+}
+
+bool SampleLog::sealSegment(const QString &source, qint64 records, const QString &target,
+                            const std::function<bool()> &interrupted, qint64 *bytes, QString *errorString)
+{
+    QFile in(source);
+    uchar *data = in.open(QIODevice::ReadOnly) && in.size() >= HeaderSize + records * RecordSize
+            ? in.map(0, HeaderSize + records * RecordSize) : nullptr;
+    if (!data) {
+        *errorString = QString("无法读取样本日志 %1: %2").arg(source, in.errorString());
+        return false;
+    }
+    QFile out(target);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *errorString = QString("无法创建 %1: %2").arg(target, out.errorString());
+        in.unmap(data);
+        return false;
+    }
+
+    // 文件头沿用原分段(创建时间不变)，只改版本
+    uchar header[HeaderSize];
+    memcpy(header, data, HeaderSize);
+    qToLittleEndian<quint16>(SealedVersion, header + 4);
+    bool ok = out.write(reinterpret_cast<const char *>(header), HeaderSize) == HeaderSize;
+
+    ChunkBuilder chunk;
+    DeviceSample sample;
+    for (qint64 i = 0; ok && i < records; ++i) {
+        if (i % kSealChunkRecords == 0 && interrupted()) {
+            *errorString = QString("封存 %1 被中断").arg(source);
+            in.unmap(data);
+            return false;
+        }
+        const bool valid = decodeRecord(data + HeaderSize + i * RecordSize, &sample);
+        if (!chunk.add(valid ? &sample : nullptr)) {
+            // 组数已满，本块提前结束
+            const QByteArray full = chunk.take();
+            ok = out.write(full) == full.size();
+            chunk.add(&sample);
+        }
+        if (chunk.size() == kSealChunkRecords || i == records - 1) {
+            const QByteArray bytes = chunk.take();
+            ok = ok && out.write(bytes) == bytes.size();
+        }
+    }
+    in.unmap(data);
+    if (!ok || !syncFile(&out)) {
+        *errorString = QString("写入 %1 失败: %2").arg(target, out.errorString());
+        return false;
+    }
+    *bytes = out.size();
+    return true;
+}
+
+void SampleLog::applyRetention()
+{
+    const qint64 cutoffMs = QDateTime::currentMSecsSinceEpoch() - m_maxAgeMs;
+    qint64 bytes = totalBytes();
+    // 活动分段不删
+    while (m_segments.size() > 1) {
+        const Segment &oldest = m_segments.first();
+        bool tooLarge = m_maxBytes > 0 && bytes > m_maxBytes;
+        bool tooOld = m_maxAgeMs > 0 && oldest.lastMs < cutoffMs;
+        if (!tooLarge && !tooOld) break;
+        if (!QFile::remove(oldest.path)) {
+            log(LogLevel::Warning, "无法删除过期的样本日志 " + oldest.path);
+            break;
+        }
+        bytes -= oldest.bytes;
+        m_segments.removeFirst();
+    }
+}
+
+QString SampleLog::segmentPath(quint32 sequence) const
+{
+    return QDir(m_directory).filePath(QString("%1.seg").arg(sequence, 8, 10, QChar('0')));
+}
+
+void SampleLog::log(LogLevel level, const QString &text) const
+{
+    LogBuffer::instance()->append(level, kSource, text);
+}
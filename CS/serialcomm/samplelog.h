@@ -0,0 +1,143 @@
+#ifndef SAMPLELOG_H
+#define SAMPLELOG_H
+
+#include <QObject>
+#include <QList>
+#include <functional>
+#include "devicesample.h"
+#include "logbuffer.h"
+
+class QFile;
+class QTimer;
+class QThread;
+
+// 解码后样本的磁盘日志: 目录下按序号命名的分段文件(00000001.seg …)，只追加、不修改。
+//
+// 分段文件 = 32 字节文件头("SMPL"、版本、记录长度、创建时间) + 数据，所有整数为小端。
+// 版本 1(活动分段)为定长记录，每条 96 字节:
+//   0 种类  1 从站  2 数值个数  3 保留  4~7 保留
+//   8 接收时间(int64 毫秒)  16 设备时间(int64 秒)  24 八个数值(int64)  88 CRC-16(前88字节)  90~95 保留
+// 写入经 QFile 缓冲，定时(默认 1 秒)flush 并 fsync，断电最多丢失这段时间的数据。
+// 活动分段超过 segmentBytes 后封闭并新开一段；封闭的分段按总大小和保存天数删除，最旧的先删。
+//
+// 封闭的分段在后台线程中压缩为版本 2(封存)，写好临时文件并 fsync 后原子地替换原文件。
+// 封存分段按写入顺序每 4096 条记录一块，块头 32 字节:
+//   0 数据长度(uint32)  4 记录数(uint32)  8 首条接收时间  16 末条接收时间  24 CRC-16(数据)  26 组数(uint16)
+// 数据为每条记录所属组的序号(各 1 字节，0xFF 表示原记录 CRC 错误)，其后各组依次为
+// 长度(uint32) + SampleBlockCodec 块；同一通道、字段数的记录为一组。
+// 记录的序号和顺序与原文件一致，读取位置(Cursor)在封存前后通用。
+//
+// 启动时不逐条解析: 记录定长，条数由文件长度得出，每段只读首尾两条记录的时间建立索引；
+// 封存分段只读各块头。只有最后一段可能因断电残留半条记录或未写完的数据，从尾部向前校验 CRC，
+// 截掉无效部分。读取时把分段映射(mmap)到内存，按时间二分定位起点(封存分段按块定位)。
+// 只在界面线程中使用；其他线程通过 snapshot() 读取。
+class SampleLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { HeaderSize = 32, RecordSize = 96, Version = 1, SealedVersion = 2 };
+
+    explicit SampleLog(QObject *parent = nullptr);
+    ~SampleLog();
+
+    // 打开(必要时创建)目录，重建索引并修复最后一段，失败时返回 false 并给出原因
+    bool open(const QString &directory, QString *errorString = nullptr);
+    void close();
+    bool isOpen() const { return m_active != nullptr; }
+    QString directory() const { return m_directory; }
+
+    void setSegmentSize(qint64 bytes);
+    // 超出任一限制时删除最旧的分段，0 表示不限
+    void setRetention(qint64 maxBytes, int maxAgeDays);
+    void setSyncInterval(int ms);
+
+    // 未打开时忽略
+    void append(const DeviceSample &sample);
+    // 写出缓冲并 fsync
+    void sync();
+
+    // 按写入顺序回放接收时间在 [fromMs, toMs] 内的样本，返回条数
+    qint64 replay(qint64 fromMs, qint64 toMs, const std::function<void(const DeviceSample &)> &visitor);
+
+    // 逐块读取的位置
+    struct Cursor {
+        quint32 sequence = 0; // 当前分段序号
+        qint64 record = -1;   // 分段内下一条记录，-1 表示按起始时间二分定位
+    };
+    // 从 *cursor 起最多检查 maxRecords 条记录，回放其中 [fromMs, toMs] 内的样本并前移 *cursor，
+    // 读完时返回 false。每次只映射一个分段，调用方按块处理时内存占用与数据总量无关
+    bool read(Cursor *cursor, qint64 fromMs, qint64 toMs, int maxRecords,
+              const std::function<void(const DeviceSample &)> &visitor);
+
+private:
+    struct Segment {
+        quint32 sequence;
+        QString path;
+        qint64 records;
+        qint64 firstMs; // 无记录时为 -1
+        qint64 lastMs;
+        quint16 version;
+        qint64 bytes;   // 文件中有效数据的大小
+    };
+
+public:
+    // 取快照时已写出的分段和记录，可交给其他线程读取: 之后的写入不影响它，分段被删除时跳过
+    class Snapshot
+    {
+    public:
+        bool read(Cursor *cursor, qint64 fromMs, qint64 toMs, int maxRecords,
+                  const std::function<void(const DeviceSample &)> &visitor) const;
+        qint64 recordCount() const;
+
+    private:
+        friend class SampleLog;
+        QList<Segment> m_segments;
+    };
+    // 会先写出缓冲中的记录
+    Snapshot snapshot();
+
+    int segmentCount() const { return m_segments.size(); }
+    // 各分段的文件大小之和(封存分段按压缩后计)
+    qint64 totalBytes() const;
+    qint64 recordCount() const;
+
+    static void encodeRecord(const DeviceSample &sample, uchar *record);
+    // CRC 不符时返回 false
+    static bool decodeRecord(const uchar *record, DeviceSample *sample);
+    // 把版本 1 分段 source 的前 records 条记录压缩写入 target(封存格式)，可在任意线程中调用；
+    // interrupted 返回 true 时放弃。成功时 *bytes 为 target 的大小
+    static bool sealSegment(const QString &source, qint64 records, const QString &target,
+                            const std::function<bool()> &interrupted, qint64 *bytes, QString *errorString);
+
+private:
+    // 校验文件头并读取首尾记录时间；repair 为 true 时截掉尾部的无效数据
+    bool scanSegment(Segment *segment, bool repair, QString *errorString) const;
+    static bool readSegments(const QList<Segment> &segments, Cursor *cursor, qint64 fromMs, qint64 toMs,
+                             int maxRecords, const std::function<void(const DeviceSample &)> &visitor);
+    bool openActive(quint32 sequence, QString *errorString);
+    void rotate();
+    // 逐个在后台封存 m_sealQueue 中的分段
+    void scheduleSeal();
+    void finishSeal();
+    void stopSeal();
+    int indexOfSegment(quint32 sequence) const;
+    void applyRetention();
+    QString segmentPath(quint32 sequence) const;
+    void log(LogLevel level, const QString &text) const;
+
+    QString m_directory;
+    QList<Segment> m_segments; // 按序号升序，最后一段为活动分段
+    QFile *m_active;
+    QTimer *m_syncTimer;
+    bool m_dirty;
+    qint64 m_segmentSize;
+    qint64 m_maxBytes;
+    qint64 m_maxAgeMs;
+    QList<quint32> m_sealQueue; // 待封存的分段序号
+    QList<quint32> m_sealRetry; // 替换失败的分段，下次轮换时再封存
+    QThread *m_sealer;          // 正在进行的封存，无则为空
+    quint32 m_sealing;          // 其分段序号
+};
+
+#endif // SAMPLELOG_H
@@ -0,0 +1,43 @@
+#include "samplereplay.h"
+#include <QElapsedTimer>
+
+namespace {
+const int kRecordsPerRead = 64 * 1024; // 每块之间检查一次中断请求
+}
+
+SampleReplay::SampleReplay(const SampleLog::Snapshot &snapshot, qint64 fromMs, qint64 toMs, int capacity,
+                           QObject *parent) :
+    QThread(parent),
+    m_snapshot(snapshot),
+    m_fromMs(fromMs),
+    m_toMs(toMs),
+    m_history(new SampleHistory()),
+    m_replayed(0),
+    m_elapsedMs(0)
+{
+    m_history->setCapacity(capacity);
+}
+
+SampleReplay::~SampleReplay()
+{
+    requestInterruption();
+    wait();
+    delete m_history;
+}
+
+void SampleReplay::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+    SampleLog::Cursor cursor;
+    qint64 replayed = 0;
+    bool more = true;
+    while (more && !isInterruptionRequested()) {
+        more = m_snapshot.read(&cursor, m_fromMs, m_toMs, kRecordsPerRead, [&](const DeviceSample &sample) {
+            m_history->append(sample);
+            ++replayed;
+        });
+        m_replayed.store(replayed);
+    }
+    m_elapsedMs = timer.elapsed();
+}
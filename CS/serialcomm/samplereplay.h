@@ -0,0 +1,40 @@
+#ifndef SAMPLEREPLAY_H
+#define SAMPLEREPLAY_H
+
+#include <QThread>
+#include <QAtomicInteger>
+#include "samplelog.h"
+#include "samplehistory.h"
+
+// 启动时把磁盘日志中一段时间的记录回放到内存历史。解码和 CRC 校验在本线程中进行，
+// 结果先放进一份单独的 SampleHistory，界面线程收到 finished() 后用 SampleHistory::swap() 换入，
+// 串口和轮询不必等回放结束。读取的是 SampleLog::snapshot()，与之后的写入互不影响。
+class SampleReplay : public QThread
+{
+    Q_OBJECT
+
+public:
+    // capacity 与目标历史的每通道容量一致
+    SampleReplay(const SampleLog::Snapshot &snapshot, qint64 fromMs, qint64 toMs, int capacity,
+                 QObject *parent = nullptr);
+    // 未完成时中断并等待线程结束
+    ~SampleReplay();
+
+    // 回放结果，finished() 之后才能在其他线程中访问
+    SampleHistory *history() const { return m_history; }
+    qint64 replayed() const { return m_replayed.load(); }
+    qint64 elapsedMs() const { return m_elapsedMs; }
+
+protected:
+    void run() override;
+
+private:
+    SampleLog::Snapshot m_snapshot;
+    qint64 m_fromMs;
+    qint64 m_toMs;
+    SampleHistory *m_history;
+    QAtomicInteger<qint64> m_replayed;
+    qint64 m_elapsedMs;
+};
+
+#endif // SAMPLEREPLAY_H
@@ -2,33 +2,100 @@ QT       += core gui serialport websockets
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# 无界面版本: qmake CONFIG+=headless，只编译采集引擎，不依赖 QtGui/QtWidgets。
+# 图形版本也可以用 --headless 参数以无界面方式运行
+headless {
+    QT      -= gui widgets
+    CONFIG  += console
+    CONFIG  -= app_bundle
+    DEFINES += SERIALCOMM_HEADLESS
+}
+
 TARGET = SerialComm
 TEMPLATE = app
 
+# 编译期生成CRC查找表需要 C++14 constexpr
+CONFIG += c++14
+
 # 核心文件
 SOURCES += \
-    main.cpp \
-    mainwindow.cpp \
-    widget.cpp
+    main.cpp
+
+# 界面(无界面版本不编译)
+!headless {
+    SOURCES += \
+        mainwindow.cpp \
+        widget.cpp
+
+    HEADERS += \
+        mainwindow.h \
+        widget.h
 
+    FORMS += \
+        mainwindow.ui \
+        widget.ui
+
+    # 新增: 添加新页面的源文件、头文件和UI文件
+    SOURCES += \
+        partialdischargewidget.cpp \
+        microwaterwidget.cpp
+    HEADERS += \
+        partialdischargewidget.h \
+        microwaterwidget.h
+    FORMS += \
+        partialdischargewidget.ui \
+        microwaterwidget.ui
+}
+
+# 采集引擎: 各设备的采集服务和共用的 WebSocket 服务(与界面无关)
+SOURCES += \
+    acquisitionengine.cpp \
+    devicemonitor.cpp \
+    ironcoremonitor.cpp \
+    partialdischargemonitor.cpp \
+    microwatermonitor.cpp \
+    websockethub.cpp \
+    samplecodec.cpp \
+    sampleblockcodec.cpp \
+    samplehistory.cpp \
+    samplelog.cpp \
+    samplereplay.cpp \
+    sampleexport.cpp \
+    logbuffer.cpp
 HEADERS += \
-    mainwindow.h \
-    widget.h
+    acquisitionengine.h \
+    devicemonitor.h \
+    ironcoremonitor.h \
+    partialdischargemonitor.h \
+    microwatermonitor.h \
+    websockethub.h \
+    samplecodec.h \
+    sampleblockcodec.h \
+    samplehistory.h \
+    samplelog.h \
+    samplereplay.h \
+    sampleexport.h \
+    logbuffer.h
 
-FORMS += \
-    mainwindow.ui \
-    widget.ui
+DISTFILES += \
+    serialcomm.example.json
 
-# 新增: 添加新页面的源文件、头文件和UI文件
+# Modbus RTU 通讯层(与界面无关)
 SOURCES += \
-    partialdischargewidget.cpp \
-    microwaterwidget.cpp
+    modbuscrc.cpp \
+    modbusrtumaster.cpp \
+    modbuspollscheduler.cpp \
+    modbusbus.cpp \
+    serialringbuffer.cpp \
+    devicesample.cpp
 HEADERS += \
-    partialdischargewidget.h \
-    microwaterwidget.h
-FORMS += \
-    partialdischargewidget.ui \
-    microwaterwidget.ui
+    modbuscrc.h \
+    modbusframeview.h \
+    modbusrtumaster.h \
+    modbuspollscheduler.h \
+    modbusbus.h \
+    serialringbuffer.h \
+    devicesample.h
 
 # 确保中文显示正常
 DEFINES += QT_DEPRECATED_WARNINGS
\ No newline at end of file
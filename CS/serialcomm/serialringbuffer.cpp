@@ -0,0 +1,74 @@
+#include "serialringbuffer.h"
+#include <QIODevice>
+#include <cstring>
+
+SerialRingBuffer::SerialRingBuffer(int capacity) :
+    m_capacity(qMax(capacity, static_cast<int>(MaxViewLength))),
+    m_head(0),
+    m_size(0)
+{
+    m_storage.resize(m_capacity + MaxViewLength);
+}
+
+void SerialRingBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
+
+qint64 SerialRingBuffer::readFrom(QIODevice *device)
+{
+    qint64 total = 0;
+    // 空闲区在存储区末尾回绕时分两段读取
+    while (freeSpace() > 0) {
+        int begin = writeIndex();
+        int chunk = qMin(freeSpace(), m_capacity - begin);
+        qint64 n = device->read(m_storage.data() + begin, chunk);
+        if (n <= 0) break;
+
+        mirrorHead(begin, begin + static_cast<int>(n));
+        m_size += static_cast<int>(n);
+        total += n;
+        if (n < chunk) break;
+    }
+    return total;
+}
+
+int SerialRingBuffer::append(const char *data, int length)
+{
+    int written = 0;
+    length = qMin(length, freeSpace());
+    while (written < length) {
+        int begin = writeIndex();
+        int chunk = qMin(length - written, m_capacity - begin);
+        std::memcpy(m_storage.data() + begin, data + written, chunk);
+        mirrorHead(begin, begin + chunk);
+        m_size += chunk;
+        written += chunk;
+    }
+    return written;
+}
+
+ModbusFrameView SerialRingBuffer::peek(int offset, int length) const
+{
+    Q_ASSERT(length <= MaxViewLength);
+    offset = qBound(0, offset, m_size);
+    length = qBound(0, length, m_size - offset);
+    return ModbusFrameView(m_storage.constData() + (m_head + offset) % m_capacity, length);
+}
+
+void SerialRingBuffer::skip(int length)
+{
+    length = qBound(0, length, m_size);
+    m_head = (m_head + length) % m_capacity;
+    m_size -= length;
+    if (m_size == 0) m_head = 0; // 空时归零，后续帧不回绕
+}
+
+void SerialRingBuffer::mirrorHead(int begin, int end)
+{
+    // 写入落在存储区开头 MaxViewLength 字节内的部分，同步复制到末尾的镜像区
+    if (begin >= MaxViewLength) return;
+    int mirrorEnd = qMin(end, static_cast<int>(MaxViewLength));
+    std::memcpy(m_storage.data() + m_capacity + begin, m_storage.constData() + begin, mirrorEnd - begin);
+}
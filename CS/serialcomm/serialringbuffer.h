@@ -0,0 +1,47 @@
+#ifndef SERIALRINGBUFFER_H
+#define SERIALRINGBUFFER_H
+
+#include <QVector>
+#include "modbusframeview.h"
+
+class QIODevice;
+
+// 串口接收用的定长环形缓冲区。
+// 存储区尾部额外镜像了开头的 MaxViewLength 字节，因此从任意位置起不超过
+// MaxViewLength 的一段数据总是连续的，可直接以 ModbusFrameView 交给解析方，无需拼接复制。
+class SerialRingBuffer
+{
+public:
+    // 一帧RTU数据的最大长度(地址+功能码+字节数+255字节数据+CRC)
+    static const int MaxViewLength = 260;
+
+    explicit SerialRingBuffer(int capacity = 4096);
+
+    int capacity() const { return m_capacity; }
+    int size() const { return m_size; }
+    int freeSpace() const { return m_capacity - m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    void clear();
+
+    // 从设备直接读入缓冲区空闲部分，返回读取字节数
+    qint64 readFrom(QIODevice *device);
+    int append(const char *data, int length);
+
+    // offset 为相对于当前读位置的偏移
+    quint8 at(int offset) const { return static_cast<quint8>(m_storage[(m_head + offset) % m_capacity]); }
+    // 连续视图，length 不得超过 MaxViewLength
+    ModbusFrameView peek(int offset, int length) const;
+    // 丢弃读位置开始的 length 字节
+    void skip(int length);
+
+private:
+    void mirrorHead(int begin, int end);
+    int writeIndex() const { return (m_head + m_size) % m_capacity; }
+
+    QVector<char> m_storage;
+    int m_capacity;
+    int m_head;
+    int m_size;
+};
+
+#endif // SERIALRINGBUFFER_H
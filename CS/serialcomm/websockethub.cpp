@@ -0,0 +1,743 @@
+#include "websockethub.h"
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QTimer>
+#include <limits>
+#include "samplecodec.h"
+#include "sampleblockcodec.h"
+
+namespace {
+const char *const kHubSource = "webSocket"; // 多路复用端口的日志来源
+const qint64 kDefaultMaxQueuedBytes = 256 * 1024;
+const qint64 kMinQueuedBytes = 4 * 1024;
+const int kDefaultFreshnessMs = 1000;
+const qint64 kReadWaiterExpiryMs = 30000; // 按需读取失败时，登记的请求方在此之后清理
+const int kDefaultHistoryPoints = 1000; // GET_HISTORY 未给 maxPoints 时的上限
+const int kDefaultExportChunkRows = 1000; // CSV 约 80KB 一块
+const int kExportChunksPerTurn = 8; // 每轮事件循环最多发送的导出块数，避免阻塞采集和其他连接
+}
+
+WebSocketHub::WebSocketHub(QObject *parent) :
+    QObject(parent),
+    m_defaultPolicy(LatestOnly),
+    m_defaultMaxQueuedBytes(kDefaultMaxQueuedBytes),
+    m_freshnessMs(kDefaultFreshnessMs),
+    m_history(nullptr),
+    m_sampleLog(nullptr),
+    m_nextExportId(1)
+{
+}
+
+WebSocketHub::~WebSocketHub()
+{
+    close();
+}
+
+void WebSocketHub::addMonitor(DeviceMonitor *monitor)
+{
+    m_monitors.append(monitor);
+    // 样本从总线线程发出，这里排队到本线程再序列化和发送
+    connect(monitor, &DeviceMonitor::sampleReady, this, [this, monitor](const DeviceSample &sample) {
+        m_lastValues.insert(streamKey(monitor->name(), sample.slaveId), CachedSample{monitor, sample});
+        publish(monitor, sample, m_readWaiters.take(readKey(monitor->name(), sample.slaveId,
+                                                            sample.address, sample.count)));
+    });
+}
+
+bool WebSocketHub::listen(quint16 port, DeviceMonitor *device)
+{
+    QString source = device ? device->name() : QString(kHubSource);
+    QWebSocketServer *server = new QWebSocketServer(source, QWebSocketServer::NonSecureMode, this);
+    if (!server->listen(QHostAddress::Any, port)) {
+        LogBuffer::instance()->append(LogLevel::Error, source, "WebSocket服务器启动失败: " + server->errorString());
+        delete server;
+        return false;
+    }
+    LogBuffer::instance()->append(LogLevel::Info, source, "WebSocket服务器启动在端口: " + QString::number(server->serverPort()));
+    connect(server, &QWebSocketServer::newConnection, this, &WebSocketHub::onNewConnection);
+    m_servers.insert(server, device);
+    return true;
+}
+
+void WebSocketHub::close()
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        disconnect(it.key(), nullptr, this, nullptr);
+        it.key()->close();
+        it.key()->deleteLater();
+    }
+    m_clients.clear();
+    qDeleteAll(m_servers.keys());
+    m_servers.clear();
+}
+
+void WebSocketHub::setBackpressure(BackpressurePolicy policy, qint64 maxQueuedBytes)
+{
+    m_defaultPolicy = policy;
+    m_defaultMaxQueuedBytes = qMax(maxQueuedBytes, kMinQueuedBytes);
+}
+
+bool WebSocketHub::policyFromName(const QString &name, BackpressurePolicy *policy)
+{
+    if (name == "dropOldest") {
+        *policy = DropOldest;
+    } else if (name == "latestOnly") {
+        *policy = LatestOnly;
+    } else if (name == "disconnect") {
+        *policy = Disconnect;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString WebSocketHub::policyName(BackpressurePolicy policy)
+{
+    switch (policy) {
+    case DropOldest: return QStringLiteral("dropOldest");
+    case LatestOnly: return QStringLiteral("latestOnly");
+    case Disconnect: return QStringLiteral("disconnect");
+    }
+    return QString();
+}
+
+void WebSocketHub::onNewConnection()
+{
+    QWebSocketServer *server = qobject_cast<QWebSocketServer *>(sender());
+    if (!server) return;
+
+    while (QWebSocket *socket = server->nextPendingConnection()) {
+        Client client;
+        client.device = m_servers.value(server);
+        client.policy = m_defaultPolicy;
+        client.maxQueuedBytes = m_defaultMaxQueuedBytes;
+        log(client, LogLevel::Info, "新的WebSocket连接: " + socket->peerAddress().toString());
+        connect(socket, &QWebSocket::textMessageReceived, this, &WebSocketHub::onTextMessageReceived);
+        connect(socket, &QWebSocket::bytesWritten, this, &WebSocketHub::onBytesWritten);
+        connect(socket, &QWebSocket::disconnected, this, &WebSocketHub::onClientDisconnected);
+        m_clients.insert(socket, client);
+
+        // 兼容端口发送设备状态和最新数据；多路复用端口发送设备列表，前端据此订阅
+        sendJson(socket, client.device ? client.device->status() : devicesMessage());
+        if (client.device) sendSnapshot(socket, m_clients[socket], QList<Topic>());
+    }
+}
+
+void WebSocketHub::onClientDisconnected()
+{
+    QWebSocket *socket = qobject_cast<QWebSocket *>(sender());
+    if (!socket || !m_clients.contains(socket)) return;
+    log(m_clients.value(socket), LogLevel::Info, "WebSocket连接断开: " + socket->peerAddress().toString());
+    m_clients.remove(socket);
+    for (QList<ReadWaiter> &waiters : m_readWaiters) {
+        for (int i = waiters.size() - 1; i >= 0; --i) {
+            if (waiters.at(i).socket == socket) waiters.removeAt(i);
+        }
+    }
+    socket->deleteLater();
+}
+
+void WebSocketHub::onTextMessageReceived(const QString &message)
+{
+    QWebSocket *socket = qobject_cast<QWebSocket *>(sender());
+    if (!socket || !m_clients.contains(socket)) return;
+    Client &client = m_clients[socket];
+    log(client, LogLevel::Info, "收到WebSocket消息: " + message);
+
+    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
+    if (!doc.isObject()) {
+        // 旧版纯文本命令
+        if (client.device && message == "GET_DATA" && !answerFromCache(socket, client, client.device, QJsonObject())) {
+            client.device->sendOnce();
+        }
+        return;
+    }
+
+    QJsonObject command = doc.object();
+    QString type = command.value("type").toString();
+    if (type == "SEND_ONCE" || type == "SEND_NOW") {
+        DeviceMonitor *monitor = client.device ? client.device : findMonitor(command.value("device").toString());
+        if (monitor && answerFromCache(socket, client, monitor, command)) return;
+        // 兼容端口总会收到本设备的数据；多路复用端口的请求方可能未订阅，登记后在数据到达时单独回复
+        if (monitor && !client.device) {
+            quint8 slaveId;
+            quint16 address;
+            quint16 count;
+            readRange(monitor, command, &slaveId, &address, &count);
+            const qint64 now = QDateTime::currentMSecsSinceEpoch();
+            auto it = m_readWaiters.begin();
+            while (it != m_readWaiters.end()) {
+                QList<ReadWaiter> &waiters = it.value();
+                for (int i = waiters.size() - 1; i >= 0; --i) {
+                    if (now - waiters.at(i).sinceMs > kReadWaiterExpiryMs) waiters.removeAt(i);
+                }
+                if (waiters.isEmpty()) {
+                    it = m_readWaiters.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            QStringList fields;
+            subscribedFields(client, monitor->name(), slaveId, &fields);
+            m_readWaiters[readKey(monitor->name(), slaveId, address, count)]
+                    .append(ReadWaiter{socket, client.binary, fields, now});
+        }
+    }
+
+    QJsonObject response;
+    if (type == "GET_SNAPSHOT") {
+        response = snapshotMessage(client.device, command);
+    } else if (type == "GET_HISTORY") {
+        response = historyMessage(client.device, command);
+    } else if (type == "EXPORT") {
+        response = startExport(socket, client, command);
+    } else if (type == "EXPORT_CANCEL") {
+        if (!client.exporter) {
+            response = errorMessage("没有进行中的导出");
+        } else {
+            finishExport(socket, client, true);
+        }
+    } else if (client.device) {
+        response = client.device->handleCommand(command);
+    } else {
+        response = handleHubCommand(client, command);
+    }
+    if (!response.isEmpty()) sendJson(socket, response);
+
+    // 订阅回复之后推送新主题的最新数据
+    if (response.value("type").toString() == "SUBSCRIPTIONS" && type == "SUBSCRIBE"
+            && m_clients.contains(socket)) {
+        QList<Topic> topics;
+        QString error;
+        if (parseTopics(command.value("topics"), &topics, &error)) sendSnapshot(socket, m_clients[socket], topics);
+    }
+}
+
+QJsonObject WebSocketHub::handleHubCommand(Client &client, const QJsonObject &command)
+{
+    QString type = command.value("type").toString();
+
+    if (type == "SUBSCRIBE" || type == "UNSUBSCRIBE") {
+        QList<Topic> topics;
+        QString error;
+        if (command.contains("topics") || type == "SUBSCRIBE") {
+            if (!parseTopics(command.value("topics"), &topics, &error)) return errorMessage(error);
+        }
+        if (type == "SUBSCRIBE") {
+            for (const Topic &topic : qAsConst(topics)) {
+                if (!client.topics.contains(topic)) client.topics.append(topic);
+            }
+        } else if (topics.isEmpty()) {
+            client.topics.clear();
+        } else {
+            for (const Topic &topic : qAsConst(topics)) client.topics.removeAll(topic);
+        }
+
+        QJsonArray subscribed;
+        for (const Topic &topic : qAsConst(client.topics)) {
+            QJsonObject object;
+            object["device"] = topic.device.isEmpty() ? QString("*") : topic.device;
+            if (topic.slaveId >= 0) object["slaveId"] = topic.slaveId;
+            if (!topic.fields.isEmpty()) object["fields"] = QJsonArray::fromStringList(topic.fields);
+            subscribed.append(object);
+        }
+        QJsonObject response;
+        response["type"] = "SUBSCRIPTIONS";
+        response["topics"] = subscribed;
+        return response;
+    }
+
+    if (type == "GET_DEVICES") return devicesMessage();
+
+    if (type == "SET_FORMAT") {
+        QString format = command.value("format").toString();
+        if (format != "binary" && format != "json") return errorMessage("未知的数据格式: " + format);
+        client.binary = format == "binary";
+        QJsonObject response;
+        response["type"] = "FORMAT_SET";
+        response["format"] = format;
+        if (client.binary) {
+            response["version"] = SampleCodec::Version;
+            response["schema"] = SampleCodec::schema();
+        }
+        return response;
+    }
+
+    if (type == "SET_BACKPRESSURE") {
+        if (command.contains("policy")
+                && !policyFromName(command.value("policy").toString(), &client.policy)) {
+            return errorMessage("未知的积压策略: " + command.value("policy").toString());
+        }
+        if (command.contains("maxQueuedBytes")) {
+            client.maxQueuedBytes = qMax(qint64(command.value("maxQueuedBytes").toDouble()), kMinQueuedBytes);
+        }
+        QJsonObject response;
+        response["type"] = "BACKPRESSURE_SET";
+        response["policy"] = policyName(client.policy);
+        response["maxQueuedBytes"] = double(client.maxQueuedBytes);
+        return response;
+    }
+
+    // 其余为设备命令
+    QString deviceName = command.value("device").toString();
+    DeviceMonitor *monitor = findMonitor(deviceName);
+    if (!monitor) return errorMessage("未知设备: " + deviceName);
+    QJsonObject response = monitor->handleCommand(command);
+    if (!response.isEmpty()) response["device"] = monitor->name();
+    return response;
+}
+
+bool WebSocketHub::parseTopics(const QJsonValue &value, QList<Topic> *topics, QString *error) const
+{
+    // 不带 topics 的 SUBSCRIBE 订阅全部
+    const QJsonArray array = value.isUndefined() ? QJsonArray{QJsonObject()} : value.toArray();
+    for (const QJsonValue &item : array) {
+        QJsonObject object = item.toObject();
+        Topic topic;
+        topic.device = object.value("device").toString();
+        if (topic.device == "*") topic.device.clear();
+        if (!topic.device.isEmpty() && !findMonitor(topic.device)) {
+            *error = "未知设备: " + topic.device;
+            return false;
+        }
+        topic.slaveId = object.value("slaveId").toInt(-1);
+        for (const QJsonValue &field : object.value("fields").toArray()) {
+            topic.fields.append(field.toString());
+        }
+        topic.fields.sort();
+        topic.fields.removeDuplicates();
+        topics->append(topic);
+    }
+    return true;
+}
+
+void WebSocketHub::publish(DeviceMonitor *monitor, const DeviceSample &sample, const QList<ReadWaiter> &waiters)
+{
+    QJsonObject data;
+    QHash<QString, Message> encoded; // 格式和字段集 -> 已序列化的消息，相同订阅只序列化一次
+    int sent = 0;
+    const QString stream = streamKey(monitor->name(), sample.slaveId);
+
+    // deliver() 可能断开连接，先取出连接列表
+    const QList<QWebSocket *> sockets = m_clients.keys();
+    for (QWebSocket *socket : sockets) {
+        auto it = m_clients.find(socket);
+        if (it == m_clients.end()) continue;
+        Client &client = it.value();
+        if (client.closing) continue;
+        QStringList fields;
+        QString key;
+        bool binary = client.binary;
+        if (client.device) {
+            if (client.device != monitor) continue;
+            key = QStringLiteral("legacy");
+        } else {
+            if (!subscribedFields(client, monitor->name(), sample.slaveId, &fields)) {
+                // 未订阅，但在等待这次按需读取的结果: 按请求时的格式和字段回复
+                const ReadWaiter *waiter = nullptr;
+                for (const ReadWaiter &candidate : waiters) {
+                    if (candidate.socket == socket) waiter = &candidate;
+                }
+                if (!waiter) continue;
+                binary = waiter->binary;
+                fields = waiter->fields;
+            }
+            key = (binary ? "binary:" : "sample:") + fields.join(',');
+        }
+
+        auto found = encoded.constFind(key);
+        if (found == encoded.constEnd()) {
+            found = encoded.insert(key, encodeSample(monitor, sample, client.device != nullptr, binary, fields, &data));
+        }
+        deliver(socket, client, stream, found.value());
+        ++sent;
+    }
+
+    if (sent > 0) {
+        LogBuffer::instance()->append(LogLevel::Debug, monitor->name(),
+                                      QString("已向 %1 个WebSocket客户端发送数据").arg(sent));
+    }
+}
+
+WebSocketHub::Message WebSocketHub::encodeSample(DeviceMonitor *monitor, const DeviceSample &sample, bool legacy,
+                                                bool binary, const QStringList &fields, QJsonObject *data)
+{
+    if (!legacy && binary) {
+        return Message::binaryMessage(SampleCodec::encode(sample, SampleCodec::fieldMask(sample.kind, fields)));
+    }
+
+    if (data->isEmpty()) *data = monitor->sampleToJson(sample);
+    QJsonObject message;
+    if (legacy) {
+        message = *data;
+    } else {
+        QJsonObject selected;
+        if (fields.isEmpty()) {
+            selected = *data;
+        } else {
+            for (const QString &field : fields) {
+                if (data->contains(field)) selected.insert(field, data->value(field));
+            }
+        }
+        message["type"] = "SAMPLE";
+        message["device"] = monitor->name();
+        message["slaveId"] = sample.slaveId;
+        message["timestamp"] = sample.timestampMs;
+        message["data"] = selected;
+    }
+    return Message::textMessage(QJsonDocument(message).toJson(QJsonDocument::Compact));
+}
+
+void WebSocketHub::sendSnapshot(QWebSocket *socket, Client &client, const QList<Topic> &topics)
+{
+    for (auto it = m_lastValues.constBegin(); it != m_lastValues.constEnd() && !client.closing; ++it) {
+        const CachedSample &cached = it.value();
+        QStringList fields;
+        if (client.device) {
+            if (client.device != cached.monitor) continue;
+        } else {
+            bool matched = false;
+            for (const Topic &topic : topics) {
+                if ((topic.device.isEmpty() || topic.device == cached.monitor->name())
+                        && (topic.slaveId < 0 || topic.slaveId == cached.sample.slaveId)) {
+                    matched = true;
+                    break;
+                }
+            }
+            if (!matched || !subscribedFields(client, cached.monitor->name(), cached.sample.slaveId, &fields)) continue;
+        }
+        QJsonObject data;
+        deliver(socket, client, it.key(),
+                encodeSample(cached.monitor, cached.sample, client.device != nullptr, client.binary, fields, &data));
+    }
+}
+
+bool WebSocketHub::answerFromCache(QWebSocket *socket, Client &client, DeviceMonitor *monitor, const QJsonObject &command)
+{
+    if (m_freshnessMs <= 0) return false;
+    quint8 slaveId;
+    quint16 address;
+    quint16 count;
+    readRange(monitor, command, &slaveId, &address, &count);
+    auto found = m_lastValues.constFind(streamKey(monitor->name(), slaveId));
+    if (found == m_lastValues.constEnd()) return false;
+    // 缓存的数据须由同一范围的读取产生(轮询任务可能读的是另一段寄存器)
+    if (found.value().sample.address != address || found.value().sample.count != count) return false;
+    qint64 ageMs = QDateTime::currentMSecsSinceEpoch() - found.value().sample.timestampMs;
+    if (ageMs > m_freshnessMs) return false;
+
+    // 未订阅该设备的多路复用客户端也按全部字段回复
+    QStringList fields;
+    if (!client.device) subscribedFields(client, monitor->name(), slaveId, &fields);
+    QJsonObject data;
+    deliver(socket, client, found.key(),
+            encodeSample(monitor, found.value().sample, client.device != nullptr, client.binary, fields, &data));
+    log(client, LogLevel::Debug, QString("使用 %1ms 前的数据回复按需读取，未访问总线").arg(ageMs));
+    return true;
+}
+
+QJsonObject WebSocketHub::snapshotMessage(DeviceMonitor *device, const QJsonObject &command) const
+{
+    QString deviceName = device ? device->name() : command.value("device").toString();
+    if (deviceName == "*") deviceName.clear();
+    if (!deviceName.isEmpty() && !findMonitor(deviceName)) return errorMessage("未知设备: " + deviceName);
+    int slaveId = command.value("slaveId").toInt(-1);
+
+    QJsonArray samples;
+    for (const CachedSample &cached : m_lastValues) {
+        if (!deviceName.isEmpty() && cached.monitor->name() != deviceName) continue;
+        if (slaveId >= 0 && cached.sample.slaveId != slaveId) continue;
+        QJsonObject item;
+        item["device"] = cached.monitor->name();
+        item["slaveId"] = cached.sample.slaveId;
+        item["timestamp"] = cached.sample.timestampMs;
+        item["data"] = cached.monitor->sampleToJson(cached.sample);
+        samples.append(item);
+    }
+    QJsonObject message;
+    message["type"] = "SNAPSHOT";
+    message["samples"] = samples;
+    return message;
+}
+
+QJsonObject WebSocketHub::historyMessage(DeviceMonitor *device, const QJsonObject &command) const
+{
+    if (!m_history) return errorMessage("未启用历史数据");
+
+    QString channel = command.value("channel").toString();
+    if (channel.isEmpty()) {
+        DeviceMonitor *monitor = device ? device : findMonitor(command.value("device").toString());
+        if (!monitor) return errorMessage("未指定通道");
+        channel = streamKey(monitor->name(), static_cast<quint8>(command.value("slaveId").toInt(monitor->slaveId())));
+    }
+    if (!m_history->channel(channel)) return errorMessage("无历史数据: " + channel);
+
+    qint64 fromMs = static_cast<qint64>(command.value("from").toDouble(0));
+    qint64 toMs = command.contains("to") ? static_cast<qint64>(command.value("to").toDouble())
+                                         : std::numeric_limits<qint64>::max();
+    int maxPoints = command.value("maxPoints").toInt(kDefaultHistoryPoints);
+
+    QString encoding = command.value("encoding").toString("json");
+    if (encoding == "block") {
+        int total = 0;
+        qint64 resolution = 0;
+        QByteArray block = SampleBlockCodec::encode(
+                    m_history->samples(channel, fromMs, toMs, maxPoints, &total, &resolution));
+        QJsonObject response;
+        response["type"] = "HISTORY";
+        response["channel"] = channel;
+        response["resolution"] = static_cast<double>(resolution);
+        response["total"] = total;
+        response["encoding"] = encoding;
+        response["block"] = QString::fromLatin1(block.toBase64());
+        return response;
+    }
+    if (encoding != "json") return errorMessage("未知的历史数据编码: " + encoding);
+
+    QStringList fields;
+    for (const QJsonValue &field : command.value("fields").toArray()) fields.append(field.toString());
+    return m_history->query(channel, fromMs, toMs, maxPoints, fields);
+}
+
+QJsonObject WebSocketHub::startExport(QWebSocket *socket, Client &client, const QJsonObject &command)
+{
+    if (!m_sampleLog || !m_sampleLog->isOpen()) return errorMessage("未启用磁盘存储，无法导出");
+    if (client.exporter) return errorMessage("已有进行中的导出");
+
+    SampleExport::Format format = SampleExport::Csv;
+    QString formatName = command.value("format").toString("csv");
+    if (!SampleExport::formatFromName(formatName, &format)) return errorMessage("未知的导出格式: " + formatName);
+
+    QStringList channels;
+    for (const QJsonValue &channel : command.value("channels").toArray()) channels.append(channel.toString());
+    if (channels.isEmpty() && client.device) channels.append(client.device->name());
+
+    qint64 fromMs = static_cast<qint64>(command.value("from").toDouble(0));
+    qint64 toMs = command.contains("to") ? static_cast<qint64>(command.value("to").toDouble())
+                                         : std::numeric_limits<qint64>::max();
+    client.exporter = QSharedPointer<SampleExport>::create(m_sampleLog, format, fromMs, toMs, channels);
+    client.exportId = m_nextExportId++;
+    client.exportChunkRows = qMax(1, command.value("chunkRows").toInt(kDefaultExportChunkRows));
+    log(client, LogLevel::Info, QString("开始导出 #%1 (%2) 到 %3")
+        .arg(client.exportId).arg(formatName, socket->peerAddress().toString()));
+
+    // 先发出本回复，再开始发送数据块
+    QTimer::singleShot(0, this, [this, socket]() { continueExport(socket); });
+
+    QJsonObject response;
+    response["type"] = "EXPORT_STARTED";
+    response["id"] = client.exportId;
+    response["format"] = formatName;
+    response["channels"] = QJsonArray::fromStringList(channels);
+    return response;
+}
+
+void WebSocketHub::continueExport(QWebSocket *socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end() || !it.value().exporter) return;
+    Client &client = it.value();
+
+    for (int chunks = 0; !client.exporter->atEnd(); ) {
+        // 积压过半时等 bytesWritten 再继续，给实时数据留出余量
+        if (client.closing || client.queuedBytes >= client.maxQueuedBytes / 2) return;
+        if (chunks == kExportChunksPerTurn) {
+            QTimer::singleShot(0, this, [this, socket]() { continueExport(socket); });
+            return;
+        }
+        ++chunks;
+        qint64 rows = 0;
+        QString data = client.exporter->nextChunk(client.exportChunkRows, &rows);
+        if (data.isEmpty()) continue; // 这段记录都被过滤掉了
+        QJsonObject chunk;
+        chunk["type"] = "EXPORT_CHUNK";
+        chunk["id"] = client.exportId;
+        chunk["rows"] = static_cast<double>(rows);
+        chunk["data"] = data;
+        sendJson(socket, chunk);
+    }
+    finishExport(socket, client, false);
+}
+
+void WebSocketHub::finishExport(QWebSocket *socket, Client &client, bool cancelled)
+{
+    QJsonObject done;
+    done["type"] = "EXPORT_DONE";
+    done["id"] = client.exportId;
+    done["rows"] = static_cast<double>(client.exporter->rows());
+    done["elapsedMs"] = static_cast<double>(client.exporter->elapsedMs());
+    done["rowsPerSecond"] = qRound(client.exporter->rowsPerSecond());
+    if (cancelled) done["cancelled"] = true;
+    log(client, LogLevel::Info, QString("导出 #%1 %2: %3 行, %4 ms, %5 行/秒")
+        .arg(client.exportId).arg(cancelled ? "已中止" : "完成")
+        .arg(client.exporter->rows()).arg(client.exporter->elapsedMs())
+        .arg(client.exporter->rowsPerSecond(), 0, 'f', 0));
+    client.exporter.reset();
+    sendJson(socket, done);
+}
+
+QString WebSocketHub::streamKey(const QString &device, quint8 slaveId)
+{
+    return device + ':' + QString::number(slaveId);
+}
+
+QString WebSocketHub::readKey(const QString &device, quint8 slaveId, quint16 address, quint16 count)
+{
+    return streamKey(device, slaveId) + ':' + QString::number(address) + ':' + QString::number(count);
+}
+
+void WebSocketHub::readRange(DeviceMonitor *monitor, const QJsonObject &command,
+                             quint8 *slaveId, quint16 *address, quint16 *count)
+{
+    *slaveId = static_cast<quint8>(command.value("slaveId").toInt(monitor->slaveId()));
+    *address = static_cast<quint16>(command.value("address").toInt(monitor->readAddress()));
+    *count = static_cast<quint16>(command.value("count").toInt(monitor->readCount()));
+}
+
+void WebSocketHub::deliver(QWebSocket *socket, Client &client, const QString &stream, const Message &message)
+{
+    if (!client.hasPending() && client.queuedBytes < client.maxQueuedBytes) {
+        write(socket, client, message);
+        return;
+    }
+
+    // 客户端跟不上
+    if (!client.congested) {
+        client.congested = true;
+        log(client, LogLevel::Warning, QString("WebSocket客户端 %1 发送积压 %2 字节，按 %3 策略处理")
+            .arg(socket->peerAddress().toString()).arg(client.queuedBytes).arg(policyName(client.policy)));
+    }
+    switch (client.policy) {
+    case Disconnect:
+        client.closing = true;
+        client.backlog.clear();
+        client.latest.clear();
+        client.latestOrder.clear();
+        socket->close(QWebSocketProtocol::CloseCodePolicyViolated, "发送积压超过上限");
+        return;
+    case LatestOnly:
+        if (client.latest.contains(stream)) {
+            ++client.dropped;
+        } else {
+            client.latestOrder.append(stream);
+        }
+        client.latest.insert(stream, message); // 共享同一份字符串，不复制
+        return;
+    case DropOldest:
+        client.backlog.enqueue(message);
+        client.backlogBytes += message.size();
+        while (client.backlogBytes > client.maxQueuedBytes && client.backlog.size() > 1) {
+            client.backlogBytes -= client.backlog.dequeue().size();
+            ++client.dropped;
+        }
+        return;
+    }
+}
+
+void WebSocketHub::write(QWebSocket *socket, Client &client, const Message &message)
+{
+    client.queuedBytes += message.binary ? socket->sendBinaryMessage(message.data)
+                                         : socket->sendTextMessage(message.text);
+}
+
+void WebSocketHub::onBytesWritten(qint64 bytes)
+{
+    QWebSocket *socket = qobject_cast<QWebSocket *>(sender());
+    if (!socket || !m_clients.contains(socket)) return;
+    Client &client = m_clients[socket];
+    // bytesWritten 含帧头，按发送时的负载计数会略微偏小，不小于 0 即可
+    client.queuedBytes = qMax(qint64(0), client.queuedBytes - bytes);
+    flushPending(socket, client);
+    if (client.exporter) continueExport(socket);
+}
+
+void WebSocketHub::flushPending(QWebSocket *socket, Client &client)
+{
+    while (client.queuedBytes < client.maxQueuedBytes && !client.backlog.isEmpty()) {
+        Message message = client.backlog.dequeue();
+        client.backlogBytes -= message.size();
+        write(socket, client, message);
+    }
+    while (client.queuedBytes < client.maxQueuedBytes && !client.latestOrder.isEmpty()) {
+        write(socket, client, client.latest.take(client.latestOrder.takeFirst()));
+    }
+    if (client.congested && !client.hasPending()) {
+        log(client, LogLevel::Info, QString("WebSocket客户端 %1 发送恢复，积压期间丢弃 %2 条数据")
+            .arg(socket->peerAddress().toString()).arg(client.dropped));
+        client.congested = false;
+        client.dropped = 0;
+    }
+}
+
+bool WebSocketHub::subscribedFields(const Client &client, const QString &device, quint8 slaveId, QStringList *fields)
+{
+    bool matched = false;
+    QStringList merged;
+    for (const Topic &topic : client.topics) {
+        if (!topic.device.isEmpty() && topic.device != device) continue;
+        if (topic.slaveId >= 0 && topic.slaveId != slaveId) continue;
+        // 任一匹配的主题要全部字段即推送全部字段
+        if (topic.fields.isEmpty()) {
+            fields->clear();
+            return true;
+        }
+        matched = true;
+        merged += topic.fields;
+    }
+    if (!matched) return false;
+    merged.sort();
+    merged.removeDuplicates();
+    *fields = merged;
+    return true;
+}
+
+QJsonObject WebSocketHub::devicesMessage() const
+{
+    QJsonArray devices;
+    for (DeviceMonitor *monitor : m_monitors) {
+        QJsonObject status = monitor->status();
+        status.remove("type");
+        status["device"] = monitor->name();
+        devices.append(status);
+    }
+    QJsonObject message;
+    message["type"] = "DEVICES";
+    message["devices"] = devices;
+    return message;
+}
+
+DeviceMonitor *WebSocketHub::findMonitor(const QString &name) const
+{
+    for (DeviceMonitor *monitor : m_monitors) {
+        if (monitor->name() == name) return monitor;
+    }
+    return nullptr;
+}
+
+void WebSocketHub::log(const Client &client, LogLevel level, const QString &text) const
+{
+    LogBuffer::instance()->append(level, client.device ? client.device->name() : QString(kHubSource), text);
+}
+
+void WebSocketHub::sendJson(QWebSocket *socket, const QJsonObject &object)
+{
+    // 命令回复直接发送，只计入积压字节
+    const Message message = Message::textMessage(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    auto it = m_clients.find(socket);
+    if (it != m_clients.end()) {
+        write(socket, it.value(), message);
+    } else {
+        socket->sendTextMessage(message.text);
+    }
+}
+
+QJsonObject WebSocketHub::errorMessage(const QString &text)
+{
+    QJsonObject message;
+    message["type"] = "ERROR";
+    message["message"] = text;
+    return message;
+}
@@ -0,0 +1,221 @@
+#ifndef WEBSOCKETHUB_H
+#define WEBSOCKETHUB_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QQueue>
+#include <QMap>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include "devicemonitor.h"
+#include "samplehistory.h"
+#include "sampleexport.h"
+
+class QWebSocketServer;
+class QWebSocket;
+
+// 所有设备共用的 WebSocket 服务，一份客户端表，每条数据按订阅分发。
+//
+// 多路复用端口(默认 8090): 前端只开一个连接，按主题订阅:
+//   {"type":"SUBSCRIBE","topics":[{"device":"partialDischarge","slaveId":1,"fields":["amount","strength"]}]}
+//   device 省略或为 "*" 时匹配所有设备，slaveId 省略时匹配所有从站，fields 省略时推送全部字段。
+//   {"type":"UNSUBSCRIBE"} 取消全部订阅，带 topics 时只取消相同的主题。
+//   带 "device" 字段的其他命令转给该设备执行(命令同各设备原协议)，回复带同样的 device 字段。
+//   推送: {"type":"SAMPLE","device":"microWater","slaveId":1,"timestamp":毫秒,"data":{...}}
+//   {"type":"SET_BACKPRESSURE","policy":"dropOldest","maxQueuedBytes":65536} 设置本连接的积压策略。
+//   {"type":"GET_SNAPSHOT","device":"microWater","slaveId":1} 回复各设备/从站的最新数据(SNAPSHOT)，
+//   device、slaveId 可省略。订阅成功后也会立即按订阅推送一遍最新数据，页面打开无需等下一次轮询。
+//   {"type":"GET_HISTORY","channel":"microWater:1","from":毫秒,"to":毫秒,"maxPoints":500} 从内存中的
+//   SampleHistory 回复一段历史数据(HISTORY，按列)，也可用 device、slaveId 指定通道；兼容端口默认为其设备。
+//   范围较宽时用 1 分钟/15 分钟/1 小时汇总回复(resolution 为桶宽，附 min/max/count)，见 SampleHistory。
+//   带 "encoding":"block" 时数据以 SampleBlockCodec 压缩块(base64)放在 block 字段中，不再逐点展开。
+//   {"type":"EXPORT","format":"csv","from":毫秒,"to":毫秒,"channels":["microWater:1"]} 从磁盘日志导出样本
+//   (格式见 SampleExport)。回复 EXPORT_STARTED 后分块发送 {"type":"EXPORT_CHUNK","id":..,"rows":..,"data":"文本"}，
+//   每块最多读取 chunkRows(默认 1000)条记录，最后 EXPORT_DONE 附行数、耗时和每秒行数；{"type":"EXPORT_CANCEL"} 中止。积压过半时暂停读取，
+//   等套接字写出后再继续，每个连接同时只有一个导出。兼容端口未给 channels 时导出其设备的全部从站。
+//   {"type":"SET_FORMAT","format":"binary"} 之后数据改为二进制消息(格式见 SampleCodec)，
+//   回复 FORMAT_SET 并附字段表；"json" 恢复文本。命令和回复始终为 JSON 文本。
+// 兼容端口(铁芯 8080、局放 8081、微水 8082): 连上即收该设备全部数据，
+// 消息格式和命令与原来各页面的服务器一致，现有前端无需修改；连上后先收到该设备的最新数据。
+//
+// 每条数据按订阅的字段集只序列化一次，所有客户端共享同一份字符串。
+// 每个连接记录已交给套接字但尚未写出的字节数，超过上限后按策略处理，
+// 慢速客户端(如 4G 网络下的浏览器)不会让服务端内存无限增长:
+//   dropOldest  暂存待发消息，暂存超过上限时丢弃最旧的
+//   latestOnly  每个设备/从站只暂存最新一条(默认)
+//   disconnect  直接断开
+// 命令回复不受策略限制。
+//
+// 按需读取(SEND_ONCE/SEND_NOW/GET_DATA)时，若该设备/从站的最新数据未超过新鲜期，
+// 直接用缓存回复请求方，不访问总线(缓存须由同一从站、地址和数量的读取产生)；
+// 相同的读取在 DeviceMonitor 中合并为一次总线事务，结果回复给每个请求方，包括未订阅该设备的连接。
+class WebSocketHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { DefaultPort = 8090 };
+
+    enum BackpressurePolicy {
+        DropOldest,
+        LatestOnly,
+        Disconnect
+    };
+
+    explicit WebSocketHub(QObject *parent = nullptr);
+    ~WebSocketHub();
+
+    // 登记设备，其数据经本服务推送
+    void addMonitor(DeviceMonitor *monitor);
+    // 在 port 上监听；device 不为空时为该设备的兼容端口
+    bool listen(quint16 port, DeviceMonitor *device = nullptr);
+    void close();
+    int clientCount() const { return m_clients.size(); }
+
+    // 新连接的默认积压策略和上限
+    void setBackpressure(BackpressurePolicy policy, qint64 maxQueuedBytes);
+    static bool policyFromName(const QString &name, BackpressurePolicy *policy);
+    static QString policyName(BackpressurePolicy policy);
+
+    // 按需读取直接用缓存回复的新鲜期，0 表示总是读总线
+    void setFreshnessWindow(int ms) { m_freshnessMs = qMax(0, ms); }
+    int freshnessWindow() const { return m_freshnessMs; }
+
+    // GET_HISTORY 查询的数据来源，未设置时该命令返回错误
+    void setHistory(const SampleHistory *history) { m_history = history; }
+    // EXPORT 读取的磁盘日志，未打开时该命令返回错误
+    void setSampleLog(SampleLog *log) { m_sampleLog = log; }
+
+private slots:
+    void onNewConnection();
+    void onClientDisconnected();
+    void onTextMessageReceived(const QString &message);
+    void onBytesWritten(qint64 bytes);
+
+private:
+    struct Topic {
+        QString device;     // 空表示所有设备
+        int slaveId = -1;   // -1 表示所有从站
+        QStringList fields; // 空表示全部字段
+
+        bool operator==(const Topic &other) const
+        {
+            return device == other.device && slaveId == other.slaveId && fields == other.fields;
+        }
+    };
+
+    // 待发送的一条消息，以发送时的形式(二进制为 QByteArray，文本为 QString)构造一次，
+    // 各客户端共享。文本的 UTF-8 字节数在构造时记下，积压字节和已交给套接字的字节用同一单位计数
+    struct Message {
+        QByteArray data; // 二进制消息
+        QString text;    // 文本消息
+        bool binary = false;
+        qint64 bytes = 0;
+
+        static Message binaryMessage(const QByteArray &data)
+        {
+            Message message;
+            message.data = data;
+            message.binary = true;
+            message.bytes = data.size();
+            return message;
+        }
+        static Message textMessage(const QByteArray &utf8)
+        {
+            Message message;
+            message.text = QString::fromUtf8(utf8);
+            message.bytes = utf8.size();
+            return message;
+        }
+        qint64 size() const { return bytes; }
+    };
+
+    // 缓存的最新数据，sample.address/count 为产生它的读取范围
+    struct CachedSample {
+        DeviceMonitor *monitor;
+        DeviceSample sample;
+    };
+
+    // 未命中缓存、已交给总线的按需读取的请求方，数据到达时即使未订阅也回复一次
+    struct ReadWaiter {
+        QWebSocket *socket;
+        bool binary;        // 请求时连接的数据格式
+        QStringList fields; // 空表示全部字段
+        qint64 sinceMs;     // 登记时刻，读取失败时据此清理
+    };
+
+    struct Client {
+        DeviceMonitor *device = nullptr; // 兼容端口的连接固定对应一个设备
+        QList<Topic> topics;
+        bool binary = false;             // 数据使用二进制格式
+
+        BackpressurePolicy policy = LatestOnly;
+        qint64 maxQueuedBytes = 0;
+        qint64 queuedBytes = 0;          // 已交给套接字、尚未写出的字节
+        QQueue<Message> backlog;         // dropOldest: 暂存的待发消息
+        qint64 backlogBytes = 0;
+        QHash<QString, Message> latest;  // latestOnly: 每个数据流暂存的最新一条
+        QList<QString> latestOrder;      // 数据流的暂存顺序
+        quint64 dropped = 0;             // 本轮积压中丢弃的消息数
+        bool congested = false;
+        bool closing = false;
+
+        QSharedPointer<SampleExport> exporter; // 进行中的导出
+        int exportId = 0;
+        int exportChunkRows = 0;
+
+        bool hasPending() const { return !backlog.isEmpty() || !latest.isEmpty(); }
+    };
+
+    // 推送给订阅的客户端和 waiters 中等待这次读取的请求方
+    void publish(DeviceMonitor *monitor, const DeviceSample &sample, const QList<ReadWaiter> &waiters);
+    // 序列化一条数据: legacy 为兼容端口的原格式，否则按 binary 和字段集；*data 为空时先填入 sampleToJson 的结果
+    static Message encodeSample(DeviceMonitor *monitor, const DeviceSample &sample, bool legacy, bool binary,
+                                const QStringList &fields, QJsonObject *data);
+    // 推送缓存中与 topics 匹配的最新数据，兼容端口的连接推送其设备的全部最新数据
+    void sendSnapshot(QWebSocket *socket, Client &client, const QList<Topic> &topics);
+    // 新鲜期内用缓存回复按需读取，已回复时返回 true
+    bool answerFromCache(QWebSocket *socket, Client &client, DeviceMonitor *monitor, const QJsonObject &command);
+    QJsonObject snapshotMessage(DeviceMonitor *device, const QJsonObject &command) const;
+    QJsonObject historyMessage(DeviceMonitor *device, const QJsonObject &command) const;
+    QJsonObject startExport(QWebSocket *socket, Client &client, const QJsonObject &command);
+    // 积压未过半时继续发送导出的下一批数据块，读完后发送 EXPORT_DONE
+    void continueExport(QWebSocket *socket);
+    void finishExport(QWebSocket *socket, Client &client, bool cancelled);
+    static QString streamKey(const QString &device, quint8 slaveId);
+    // 按需读取的标识: 设备、从站、起始地址和数量
+    static QString readKey(const QString &device, quint8 slaveId, quint16 address, quint16 count);
+    // 按命令中的参数(缺省取设备当前参数)得出本次按需读取的从站、地址和数量
+    static void readRange(DeviceMonitor *monitor, const QJsonObject &command,
+                          quint8 *slaveId, quint16 *address, quint16 *count);
+    // 按积压策略发送一条数据，stream 标识数据流(设备/从站)
+    void deliver(QWebSocket *socket, Client &client, const QString &stream, const Message &message);
+    void write(QWebSocket *socket, Client &client, const Message &message);
+    // 积压回落后发送暂存的消息
+    void flushPending(QWebSocket *socket, Client &client);
+    // 客户端对该设备/从站的订阅，未订阅返回 false；*fields 为空表示全部字段
+    static bool subscribedFields(const Client &client, const QString &device, quint8 slaveId, QStringList *fields);
+    QJsonObject handleHubCommand(Client &client, const QJsonObject &command);
+    bool parseTopics(const QJsonValue &value, QList<Topic> *topics, QString *error) const;
+    QJsonObject devicesMessage() const;
+    DeviceMonitor *findMonitor(const QString &name) const;
+    void log(const Client &client, LogLevel level, const QString &text) const;
+    void sendJson(QWebSocket *socket, const QJsonObject &object);
+    static QJsonObject errorMessage(const QString &text);
+
+    QList<DeviceMonitor *> m_monitors;
+    QHash<QWebSocketServer *, DeviceMonitor *> m_servers; // 多路复用端口对应 nullptr
+    QHash<QWebSocket *, Client> m_clients;
+    QMap<QString, CachedSample> m_lastValues; // "设备:从站" -> 最新数据
+    QHash<QString, QList<ReadWaiter>> m_readWaiters; // readKey() -> 等待该读取结果的请求方
+    BackpressurePolicy m_defaultPolicy;
+    qint64 m_defaultMaxQueuedBytes;
+    int m_freshnessMs;
+    const SampleHistory *m_history;
+    SampleLog *m_sampleLog;
+    int m_nextExportId;
+};
+
+#endif // WEBSOCKETHUB_H
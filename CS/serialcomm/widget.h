@@ -2,52 +2,37 @@
 #define WIDGET_H
 
 #include <QWidget>
-#include <QSerialPort>
 #include <QSerialPortInfo>
-#include <QWebSocketServer>
-#include <QWebSocket>
 #include <QTimer>
+#include "ironcoremonitor.h"
 
 namespace Ui {
 class Widget;
 }
 
+// 铁芯接地电流页面: 采集、WebSocket 服务都在 IronCoreMonitor 中，页面只负责串口操作和显示日志
 class Widget : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit Widget(QWidget *parent = nullptr);
+    explicit Widget(IronCoreMonitor *ironCore, QWidget *parent = nullptr);
     ~Widget();
 
 private slots:
     void on_connectButton_clicked();
     void on_disconnectButton_clicked();
-    void readSerialData();
-    void onNewWebSocketConnection();
-    void onWebSocketDisconnected();
-    void onWebSocketMessageReceived(const QString &message);
-    void sendRequest();
-    void tryParseBuffer();
+    void onPortStateChanged(bool open);
+    void refreshLog();
     void onReturnToHome();
 
 signals:
     void returnToHomeRequested();
 private:
     Ui::Widget *ui;
-    QSerialPort *serial;
-    QWebSocketServer *webSocketServer;
-    QTimer *requestTimer;
-    QList<QWebSocket*> clients;
-    QByteArray serialBuffer;  // 添加缓冲区成员变量
-    int sendIntervalMs;
-
-
-    quint16 calculateCRC(const QByteArray &data);
-    QByteArray buildRequest(quint8 address, quint8 functionCode,
-                          quint16 startReg, quint16 regCount);
-    void parseResponse(const QByteArray &data);
-    void sendStatusToClient(QWebSocket *client);
+    IronCoreMonitor *monitor;
+    QTimer *logTimer;
+    quint64 logSequence; // 日志框已显示到的日志序号
 };
 
 #endif // WIDGET_H